@@ -0,0 +1,85 @@
+#include "BufferedWriter.hpp"
+#include <cstdarg>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+BufferedWriter::BufferedWriter(size_t capacity)
+    : file(nullptr), ownsFile(false), buffer(capacity), used(0) {}
+
+BufferedWriter::~BufferedWriter() {
+    try {
+        close();
+    } catch (const exception &) {
+        // Os erros só podem ser reportados por close() explícito
+    }
+}
+
+void BufferedWriter::open(const string &name) {
+    close();
+    filename = name;
+    if (name == "-") {
+        file = stdout;
+        ownsFile = false;
+    } else {
+        file = fopen(name.c_str(), "wb");
+        ownsFile = true;
+    }
+    if (!file)
+        throw runtime_error("Erro ao abrir " + name + " para escrita");
+}
+
+void BufferedWriter::close() {
+    if (!file)
+        return;
+    flush();
+    FILE *closing = file;
+    file = nullptr;
+    if (ownsFile ? fclose(closing) != 0 : fflush(closing) != 0)
+        throw runtime_error("Erro a escrever em " + filename);
+}
+
+void BufferedWriter::flush() {
+    if (used > 0 && fwrite(buffer.data(), 1, used, file) != used)
+        throw runtime_error("Erro a escrever em " + filename);
+    used = 0;
+}
+
+void BufferedWriter::write(const void *data, size_t size) {
+    if (used + size > buffer.size()) {
+        flush();
+        // Blocos maiores do que o buffer vão diretamente para o ficheiro
+        if (size > buffer.size()) {
+            if (fwrite(data, 1, size, file) != size)
+                throw runtime_error("Erro a escrever em " + filename);
+            return;
+        }
+    }
+    memcpy(buffer.data() + used, data, size);
+    used += size;
+}
+
+void BufferedWriter::write(const string &text) {
+    write(text.data(), text.size());
+}
+
+void BufferedWriter::print(const char *format, ...) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        va_list args;
+        va_start(args, format);
+        size_t available = buffer.size() - used;
+        int written = vsnprintf(buffer.data() + used, available, format, args);
+        va_end(args);
+        if (written < 0)
+            throw runtime_error("Erro de formatação ao escrever em " + filename);
+        if (static_cast<size_t>(written) < available) {
+            used += written;
+            return;
+        }
+        // Não coube: esvazia o buffer e tenta de novo (ou cresce, se nem vazio chega)
+        flush();
+        if (static_cast<size_t>(written) >= buffer.size())
+            buffer.resize(written + 1);
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef BUFFEREDWRITER_HPP
+#define BUFFEREDWRITER_HPP
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Escrita com um buffer grande próprio, para evitar o custo por chamada dos
+// iostreams formatados quando se escrevem milhões de valores. Lança runtime_error
+// em caso de erro.
+class BufferedWriter {
+public:
+    explicit BufferedWriter(size_t capacity = 1 << 20);
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator=(const BufferedWriter &) = delete;
+
+    // "-" escreve para a saída padrão
+    void open(const string &filename);
+    void close();
+
+    void write(const void *data, size_t size);
+    void write(const string &text);
+
+    // Escreve o valor na representação binária nativa
+    template <typename T>
+    void writeValue(const T &value) {
+        write(&value, sizeof(T));
+    }
+
+    // Formatação ao estilo printf diretamente no buffer
+    void print(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    void flush();
+
+private:
+    FILE *file;
+    bool ownsFile;
+    string filename;
+    vector<char> buffer;
+    size_t used;
+};
+
+#endif
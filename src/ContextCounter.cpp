@@ -0,0 +1,477 @@
+#include "ContextCounter.hpp"
+#include "Nucleotide.hpp"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+using namespace std;
+
+unsigned long power4(int k) {
+    unsigned long res = 1;
+    for (int i = 0; i < k; i++)
+        res *= 4;
+    return res;
+}
+
+// Memória máxima para as cópias por thread da tabela densa; acima disso cada
+// thread conta uma gama de contextos em vez de uma parte da sequência
+static const size_t DENSE_SHARD_BUDGET = 256u << 20;
+
+static void checkLength(const string& sequence, int k) {
+    if (sequence.size() < static_cast<size_t>(k + 1))
+        throw runtime_error("Sequência demasiado curta para o valor de k fornecido.");
+}
+
+// Chama visit(j, código) para os n símbolos a partir de start: os caracteres passam
+// pelo núcleo de conversão; os códigos (de ContextStream) são usados diretamente
+template <typename Visit>
+static void forEachSymbol(const string& sequence, size_t start, size_t n, Visit visit) {
+    forEachNucleotide(sequence.data() + start, n, visit);
+}
+
+template <typename Visit>
+static void forEachSymbol(const vector<uint8_t>& codes, size_t start, size_t n, Visit visit) {
+    const uint8_t* data = codes.data() + start;
+    for (size_t j = 0; j < n; j++)
+        visit(j, data[j]);
+}
+
+// Percorre a sequência (caracteres ou códigos) com o contexto em janela deslizante e chama
+// count(contexto, símbolo) em cada posição de [begin, end) com k símbolos válidos
+// antes dela. A janela começa k símbolos antes de begin, pelo que os troços de
+// uma partição da sequência contam exatamente as posições da passagem completa.
+//
+// Com invertedRepeats cada posição conta também a da cadeia complementar
+// invertida: os k + 1 símbolos x[i-k..i] lidos ao contrário e complementados
+// (3 - símbolo troca A/T e C/G) dão o contexto comp(x[i])..comp(x[i-k+1]) e o
+// símbolo comp(x[i-k]). Esse contexto é mantido como o direto, com cada símbolo
+// novo a entrar pelos bits mais altos, pelo que as contagens são as de countContexts
+// sobre a sequência seguida do seu complemento invertido (separados por um inválido)
+template <typename Sequence, typename Counter>
+static void forEachContext(const Sequence& sequence, int k, size_t begin, size_t end, bool invertedRepeats,
+                           Counter count) {
+    const unsigned long mask = power4(k) - 1;
+    const int oldestShift = 2 * (k - 1);
+    unsigned long context = 0;
+    unsigned long inverted = 0;
+    int validRun = 0;
+    const size_t start = begin > static_cast<size_t>(k) ? begin - k : 0;
+    if (end <= start)
+        return;
+    forEachSymbol(sequence, start, end - start, [&](size_t j, int sym) {
+        if (sym == NUCLEOTIDE_INVALID) {
+            validRun = 0;
+            context = 0;
+            inverted = 0;
+            return;
+        }
+        inverted = (inverted >> 2) | (static_cast<unsigned long>(3 - sym) << oldestShift);
+        if (validRun >= k) {
+            if (start + j >= begin) {
+                count(context, sym);
+                if (invertedRepeats)
+                    count(inverted, 3 - static_cast<int>(context >> oldestShift));
+            }
+        } else {
+            validRun++;
+        }
+        context = ((context << 2) | sym) & mask;
+    });
+}
+
+// Fronteira do troço part de parts em que [begin, end) é dividido
+static size_t chunkBoundary(size_t begin, size_t end, size_t part, size_t parts) {
+    return begin + (end - begin) / parts * part + min(part, (end - begin) % parts);
+}
+
+// Soma às contagens densas as posições de [begin, fim da sequência), em paralelo
+// se houver pool
+template <typename Sequence>
+static void addDenseCounts(const Sequence& sequence, int k, size_t begin, bool invertedRepeats, ThreadPool* pool,
+                           vector<int>& counts) {
+    const size_t end = sequence.size();
+    if (!pool) {
+        forEachContext(sequence, k, begin, end, invertedRepeats, [&counts](unsigned long context, int sym) {
+            counts[context * 4 + sym]++;
+        });
+        return;
+    }
+
+    const size_t parts = pool->size();
+    if (counts.size() * sizeof(int) * parts <= DENSE_SHARD_BUDGET) {
+        // Cada thread conta um troço da sequência na sua cópia da tabela; as cópias
+        // são depois somadas, também em paralelo, por gamas de entradas
+        vector<vector<int>> shards(parts);
+        pool->parallelFor(0, parts, [&](size_t part) {
+            vector<int>& shard = shards[part];
+            shard.assign(counts.size(), 0);
+            forEachContext(sequence, k, chunkBoundary(begin, end, part, parts), chunkBoundary(begin, end, part + 1, parts), invertedRepeats,
+                           [&shard](unsigned long context, int sym) {
+                shard[context * 4 + sym]++;
+            });
+        });
+        const size_t blockSize = 1 << 16;
+        pool->parallelFor(0, (counts.size() + blockSize - 1) / blockSize, [&](size_t block) {
+            size_t last = min(counts.size(), (block + 1) * blockSize);
+            for (const vector<int>& shard : shards)
+                for (size_t i = block * blockSize; i < last; i++)
+                    counts[i] += shard[i];
+        });
+        return;
+    }
+
+    // Tabela grande: cada thread percorre a sequência inteira mas só conta os
+    // contextos da sua gama, pelo que escreve numa parte disjunta da tabela sem
+    // cópias nem operações atómicas (e com menos falhas de cache)
+    const unsigned long contexts = counts.size() / 4;
+    pool->parallelFor(0, parts, [&](size_t part) {
+        unsigned long first = contexts / parts * part;
+        unsigned long last = part + 1 == parts ? contexts : contexts / parts * (part + 1);
+        forEachContext(sequence, k, begin, end, invertedRepeats, [&counts, first, last](unsigned long context, int sym) {
+            if (context >= first && context < last)
+                counts[context * 4 + sym]++;
+        });
+    });
+}
+
+// Chama add(contexto, símbolo, contagem) para cada contagem não nula
+template <typename Add>
+static void forEachCount(const ContextCounts& counts, Add add) {
+    if (counts.sparse) {
+        const SparseEntry* entries = counts.table.data();
+        for (size_t slot = 0; slot < counts.table.capacity(); slot++) {
+            const SparseEntry& entry = entries[slot];
+            if (entry.key == 0)
+                continue;
+            for (int s = 0; s < 4; s++)
+                if (entry.counts[s] > 0)
+                    add(entry.key - 1, s, entry.counts[s]);
+        }
+    } else {
+        for (size_t i = 0; i < counts.dense.size(); i++)
+            if (counts.dense[i] > 0)
+                add(i / 4, i % 4, counts.dense[i]);
+    }
+}
+
+// Soma à tabela esparsa as posições de [begin, fim da sequência); em paralelo cada
+// thread conta um troço numa tabela própria e as tabelas são depois somadas
+template <typename Sequence>
+static void addSparseCounts(const Sequence& sequence, int k, size_t begin, bool invertedRepeats, ThreadPool* pool,
+                            SparseTable& table) {
+    const size_t end = sequence.size();
+    if (!pool) {
+        forEachContext(sequence, k, begin, end, invertedRepeats, [&table](unsigned long context, int sym) {
+            table.increment(context, sym);
+        });
+        return;
+    }
+
+    const size_t parts = pool->size();
+    vector<ContextCounts> shards(parts);
+    pool->parallelFor(0, parts, [&](size_t part) {
+        size_t first = chunkBoundary(begin, end, part, parts);
+        size_t last = chunkBoundary(begin, end, part + 1, parts);
+        ContextCounts& shard = shards[part];
+        shard = ContextCounts{k, true, {}, SparseTable(min(static_cast<size_t>(power4(k)), last - first) / 4)};
+        forEachContext(sequence, k, first, last, invertedRepeats, [&shard](unsigned long context, int sym) {
+            shard.table.increment(context, sym);
+        });
+    });
+    size_t part = 0;
+    if (table.size() == 0)
+        table = move(shards[part++].table);
+    for (; part < parts; part++) {
+        forEachCount(shards[part], [&table](unsigned long context, int sym, uint32_t count) {
+            table.add(context, sym, count);
+        });
+        shards[part] = ContextCounts();
+    }
+}
+
+static unique_ptr<ThreadPool> makePool(unsigned threads) {
+    return threads == 1 ? nullptr : make_unique<ThreadPool>(threads);
+}
+
+vector<int> countContexts(const string& sequence, int k, unsigned threads) {
+    checkLength(sequence, k);
+    statsAdd(STAT_SYMBOLS_COUNTED, sequence.size());
+    // Vetor de contagens: cada contexto (4^k) com 4 possíveis símbolos seguintes
+    vector<int> counts(power4(k) * 4, 0);
+    addDenseCounts(sequence, k, 0, false, makePool(threads).get(), counts);
+    return counts;
+}
+
+SparseTable countContextsSparse(const string& sequence, int k, unsigned threads) {
+    checkLength(sequence, k);
+    statsAdd(STAT_SYMBOLS_COUNTED, sequence.size());
+    // No máximo existe um contexto distinto por posição; a tabela começa com uma
+    // fração desse limite, cresce se necessário e é compactada no fim
+    size_t positions = sequence.size() - k;
+    SparseTable table(min(static_cast<size_t>(power4(k)), positions) / 4);
+    addSparseCounts(sequence, k, 0, false, makePool(threads).get(), table);
+    table.shrinkToFit();
+    return table;
+}
+
+ContextStream::ContextStream(int k, bool sparse, unsigned threads, bool invertedRepeats)
+    : k(k), invertedRepeats(invertedRepeats), counts{k, sparse, {}, SparseTable()}, pool(makePool(threads)), total(0),
+      run{0, 0}, invertedRun{0, 0}, inRun(false) {
+    if (!sparse)
+        counts.dense.assign(power4(k) * 4, 0);
+}
+
+ContextStream::~ContextStream() = default;
+
+void ContextStream::add(const string& block) {
+    vector<uint8_t> codes(block.size());
+    encodeNucleotides(block.data(), block.size(), codes.data());
+    add(codes);
+}
+
+void ContextStream::add(const vector<uint8_t>& block) {
+    // Os últimos k símbolos do bloco anterior reconstroem o contexto das
+    // primeiras posições deste; só as posições do bloco são contadas
+    size_t begin = window.size();
+    window.insert(window.end(), block.begin(), block.end());
+    statsAdd(STAT_SYMBOLS_COUNTED, block.size());
+    if (counts.sparse)
+        addSparseCounts(window, k, begin, invertedRepeats, pool.get(), counts.table);
+    else
+        addDenseCounts(window, k, begin, invertedRepeats, pool.get(), counts.dense);
+    window.erase(window.begin(), window.end() - min(window.size(), static_cast<size_t>(k)));
+    total += block.size();
+
+    // Os k primeiros símbolos de cada sequência de símbolos válidos e, com
+    // invertedRepeats, os da sua complementar invertida (os k últimos,
+    // complementados e pela ordem inversa)
+    const int oldestShift = 2 * (k - 1);
+    for (uint8_t sym : block) {
+        if (sym == NUCLEOTIDE_INVALID) {
+            endRun();
+            continue;
+        }
+        inRun = true;
+        if (run.symbols < k) {
+            run.packed = (run.packed << 2) | sym;
+            run.symbols++;
+        }
+        invertedRun.packed = (invertedRun.packed >> 2) | (static_cast<uint64_t>(3 - sym) << oldestShift);
+        invertedRun.symbols = min(invertedRun.symbols + 1, k);
+    }
+}
+
+void ContextStream::endRun() {
+    if (inRun) {
+        prefixes.push_back(run);
+        // Os símbolos da complementar entram pelos bits mais altos: com menos de k
+        // símbolos estão no topo e são alinhados à direita
+        if (invertedRepeats)
+            prefixes.push_back(RunPrefix{invertedRun.packed >> 2 * (k - invertedRun.symbols), invertedRun.symbols});
+    }
+    run = RunPrefix{0, 0};
+    invertedRun = RunPrefix{0, 0};
+    inRun = false;
+}
+
+size_t ContextStream::length() const {
+    return total;
+}
+
+ContextCounts ContextStream::finish(vector<RunPrefix>& runPrefixes) {
+    if (total < static_cast<size_t>(k + 1))
+        throw runtime_error("Sequência demasiado curta para o valor de k fornecido.");
+    endRun();
+    if (counts.sparse)
+        counts.table.shrinkToFit();
+    runPrefixes = move(prefixes);
+    return move(counts);
+}
+
+// Soma count ocorrências às contagens, em qualquer das representações, saturando
+// no máximo da contagem (INT_MAX nas densas, guardadas e lidas como int; UINT32_MAX
+// nas esparsas) em vez de dar a volta. Devolve true se a contagem saturou
+static bool addCount(ContextCounts& counts, unsigned long context, int sym, uint32_t count) {
+    if (counts.sparse)
+        return counts.table.add(context, sym, count);
+    int& target = counts.dense[context * 4 + sym];
+    int64_t sum = static_cast<int64_t>(target) + count;
+    target = static_cast<int>(min<int64_t>(sum, INT_MAX));
+    return sum > INT_MAX;
+}
+
+static void warnSaturated(size_t saturated, int k) {
+    if (saturated > 0)
+        cerr << "Aviso: " << saturated << " somas de contagens de k = " << k << " saturaram no máximo da contagem" << endl;
+}
+
+// Contagens vazias de ordem k; a tabela esparsa é dimensionada para expectedContexts
+static ContextCounts emptyCounts(int k, bool sparse, size_t expectedContexts) {
+    ContextCounts counts{k, sparse, {}, SparseTable()};
+    if (sparse)
+        counts.table = SparseTable(min(static_cast<size_t>(power4(k)), expectedContexts) / 4);
+    else
+        counts.dense.assign(power4(k) * 4, 0);
+    return counts;
+}
+
+static size_t contextCount(const ContextCounts& counts) {
+    return counts.sparse ? counts.table.size() : counts.dense.size() / 4;
+}
+
+ContextCounts convertCounts(const ContextCounts& counts, bool sparse) {
+    ContextCounts converted = emptyCounts(counts.k, sparse, contextCount(counts));
+    size_t saturated = 0;
+    forEachCount(counts, [&converted, &saturated](unsigned long context, int sym, uint32_t count) {
+        saturated += addCount(converted, context, sym, count);
+    });
+    warnSaturated(saturated, counts.k);
+    if (sparse)
+        converted.table.shrinkToFit();
+    return converted;
+}
+
+ContextCounts lowerOrder(const ContextCounts& higher, const vector<RunPrefix>& prefixes, bool sparse) {
+    const int k = higher.k - 1;
+    if (k < 1)
+        throw runtime_error("Não existe ordem inferior a 1.");
+    const unsigned long mask = power4(k) - 1;
+    ContextCounts lower = emptyCounts(k, sparse, contextCount(higher));
+
+    // O contexto de ordem k é o de ordem k + 1 sem o símbolo mais antigo (bits mais altos)
+    size_t saturated = 0;
+    forEachCount(higher, [&lower, &saturated, mask](unsigned long context, int sym, uint32_t count) {
+        saturated += addCount(lower, context & mask, sym, count);
+    });
+
+    // Posição k de cada sequência de símbolos válidos: contexto com os k primeiros símbolos
+    for (const RunPrefix& run : prefixes) {
+        if (run.symbols <= k)
+            continue;
+        int shift = 2 * (run.symbols - k);
+        saturated += addCount(lower, run.packed >> shift, (run.packed >> (shift - 2)) & 3, 1);
+    }
+    warnSaturated(saturated, k);
+
+    if (sparse)
+        lower.table.shrinkToFit();
+    return lower;
+}
+
+CountsView viewCounts(const ContextCounts& counts) {
+    if (counts.sparse)
+        return CountsView{counts.k, true, sizeof(SparseEntry), counts.table.data(), counts.table.capacity()};
+    return CountsView{counts.k, false, sizeof(int), counts.dense.data(), counts.dense.size()};
+}
+
+// Chama add(contexto, símbolo, contagem) para cada contagem não nula das posições
+// [first, last) de uma tabela densa com contagens do tipo CountT
+template <typename CountT, typename Add>
+static void forEachDenseCount(const void* table, size_t first, size_t last, Add add) {
+    const CountT* counts = static_cast<const CountT*>(table);
+    for (size_t i = first; i < last; i++)
+        if (counts[i] > 0)
+            add(i / 4, i % 4, counts[i]);
+}
+
+// Como forEachCount, mas só para as entradas [first, last) da vista
+template <typename Add>
+static void forEachCount(const CountsView& view, size_t first, size_t last, Add add) {
+    if (view.sparse) {
+        const SparseEntry* entries = static_cast<const SparseEntry*>(view.table);
+        for (size_t slot = first; slot < last; slot++) {
+            const SparseEntry& entry = entries[slot];
+            if (entry.key == 0)
+                continue;
+            for (int s = 0; s < 4; s++)
+                if (entry.counts[s] > 0)
+                    add(entry.key - 1, s, entry.counts[s]);
+        }
+    } else if (view.width == 1) {
+        forEachDenseCount<uint8_t>(view.table, first, last, add);
+    } else if (view.width == 2) {
+        forEachDenseCount<uint16_t>(view.table, first, last, add);
+    } else {
+        forEachDenseCount<uint32_t>(view.table, first, last, add);
+    }
+}
+
+ContextCounts sumCounts(const vector<CountsView>& inputs, bool sparse, unsigned threads) {
+    if (inputs.empty())
+        throw runtime_error("Não há contagens para somar.");
+    const int k = inputs[0].k;
+    size_t expectedContexts = 0;
+    for (const CountsView& view : inputs) {
+        if (view.k != k)
+            throw runtime_error("Não é possível somar modelos de ordens diferentes (k = " + to_string(k) +
+                                " e k = " + to_string(view.k) + ").");
+        expectedContexts = max(expectedContexts, view.sparse ? view.entries / 2 : view.entries / 4);
+    }
+    unique_ptr<ThreadPool> pool = makePool(threads);
+    // Somas que saturaram; só são contadas quando acontecem, pelo que o atómico
+    // não pesa no caso normal
+    atomic<size_t> saturated(0);
+
+    if (!sparse || !pool) {
+        ContextCounts sum = emptyCounts(k, sparse, expectedContexts);
+        auto add = [&sum, &saturated](unsigned long context, int sym, uint32_t count) {
+            if (addCount(sum, context, sym, count))
+                saturated++;
+        };
+        for (const CountsView& view : inputs) {
+            if (!pool) {
+                forEachCount(view, 0, view.entries, add);
+                continue;
+            }
+            // Cada entrada de uma tabela densa é uma contagem distinta e cada entrada
+            // de uma esparsa um contexto distinto, pelo que gamas disjuntas de entradas
+            // escrevem em posições disjuntas da soma
+            const size_t blockSize = 1 << 16;
+            pool->parallelFor(0, (view.entries + blockSize - 1) / blockSize, [&](size_t block) {
+                forEachCount(view, block * blockSize, min(view.entries, (block + 1) * blockSize), add);
+            });
+        }
+        if (sparse)
+            sum.table.shrinkToFit();
+        warnSaturated(saturated, k);
+        return sum;
+    }
+
+    // Cada thread percorre todas as tabelas mas só soma os contextos da sua parte
+    // (contexto mod parts); as partes têm contextos disjuntos e são depois juntadas
+    const size_t parts = pool->size();
+    vector<ContextCounts> shards(parts);
+    pool->parallelFor(0, parts, [&](size_t part) {
+        ContextCounts& shard = shards[part];
+        shard = emptyCounts(k, true, expectedContexts / parts);
+        for (const CountsView& view : inputs) {
+            forEachCount(view, 0, view.entries, [&shard, &saturated, part, parts](unsigned long context, int sym, uint32_t count) {
+                if (context % parts == part && shard.table.add(context, sym, count))
+                    saturated++;
+            });
+        }
+    });
+    ContextCounts sum = move(shards[0]);
+    for (size_t part = 1; part < parts; part++) {
+        forEachCount(shards[part], [&sum](unsigned long context, int sym, uint32_t count) {
+            sum.table.add(context, sym, count);
+        });
+        shards[part] = ContextCounts();
+    }
+    sum.table.shrinkToFit();
+    warnSaturated(saturated, k);
+    return sum;
+}
+
+bool preferSparse(size_t length, int k) {
+    if (k >= 16)
+        return true;
+    if (length <= static_cast<size_t>(k))
+        return false;
+    return power4(k) * 16 > (length - k) * 64;
+}
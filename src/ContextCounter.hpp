@@ -0,0 +1,121 @@
+#ifndef CONTEXTCOUNTER_HPP
+#define CONTEXTCOUNTER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "SparseTable.hpp"
+
+using namespace std;
+
+class ThreadPool;
+
+// Calcula 4^k
+unsigned long power4(int k);
+
+// Calcula as contagens dos contextos utilizando a técnica de janela deslizante.
+// Um símbolo inválido reinicia a janela: só são contadas as posições precedidas
+// de k símbolos válidos, tal como na pontuação em MetaClass.
+//
+// Com threads != 1 (0 usa todos os núcleos) a contagem é paralela e o resultado
+// é igual ao da versão sequencial
+vector<int> countContexts(const string& sequence, int k, unsigned threads = 1);
+
+// Versão esparsa de countContexts: só os contextos que ocorrem ocupam memória,
+// o que permite valores de k para os quais 4^k contextos não caberiam em RAM.
+// As contagens paralelas são iguais às sequenciais, mas a disposição da tabela
+// de dispersão pode ser diferente
+SparseTable countContextsSparse(const string& sequence, int k, unsigned threads = 1);
+
+// Contagens de um modelo de ordem k, numa das duas representações
+struct ContextCounts {
+    int k;
+    bool sparse;
+    vector<int> dense;
+    SparseTable table;
+};
+
+// Tabela de contagens só de leitura, e.g. a de um modelo mapeado em memória: densa,
+// com entries contagens de width bytes, ou esparsa, com entries entradas SparseEntry
+struct CountsView {
+    int k;
+    bool sparse;
+    int width;
+    const void* table;
+    size_t entries;
+};
+
+// Vista sobre contagens em memória
+CountsView viewCounts(const ContextCounts& counts);
+
+// Soma tabelas de contagens da mesma ordem (em qualquer representação e largura)
+// na representação pedida; lança runtime_error se as ordens forem diferentes.
+// Uma soma que não caiba na contagem satura no máximo, com um aviso.
+// Com threads != 1 a soma é paralela: na densa cada thread soma uma gama de entradas
+// de cada tabela e na esparsa os contextos de uma parte, numa tabela própria
+ContextCounts sumCounts(const vector<CountsView>& inputs, bool sparse, unsigned threads = 1);
+
+// Início de uma sequência de símbolos válidos consecutivos: os primeiros symbols
+// (no máximo a ordem mais alta) empacotados a 2 bits, o mais antigo nos bits mais altos
+struct RunPrefix {
+    uint64_t packed;
+    int symbols;
+};
+
+// Contagem de uma sequência recebida por blocos (e.g. lida por partes de um
+// ficheiro ou de stdin): a memória usada é a da tabela mais a de um bloco,
+// independente do tamanho da sequência. As contagens são iguais às de
+// countContexts/countContextsSparse sobre a concatenação dos blocos.
+//
+// Com invertedRepeats cada posição também conta o contexto da cadeia complementar
+// invertida, atualizado na mesma passagem; as contagens (e os prefixes de finish)
+// são as da sequência seguida do seu complemento invertido
+class ContextStream {
+public:
+    ContextStream(int k, bool sparse, unsigned threads = 1, bool invertedRepeats = false);
+    ~ContextStream();
+
+    void add(const string& block);
+
+    // Como add, mas com o bloco já convertido nos códigos 0-3 ou NUCLEOTIDE_INVALID
+    // de encodeNucleotides, que são contados sem nova conversão
+    void add(const vector<uint8_t>& block);
+
+    // Número de símbolos recebidos
+    size_t length() const;
+
+    // Devolve as contagens e, em prefixes, o início de cada sequência de símbolos
+    // válidos, de onde lowerOrder obtém as posições que só as ordens inferiores contam
+    ContextCounts finish(vector<RunPrefix>& prefixes);
+
+private:
+    int k;
+    bool invertedRepeats;
+    ContextCounts counts;
+    unique_ptr<ThreadPool> pool;
+    vector<uint8_t> window;    // códigos dos últimos k símbolos recebidos
+    size_t total;
+    vector<RunPrefix> prefixes;
+    RunPrefix run;
+    RunPrefix invertedRun;     // últimos k símbolos da sequência atual, complementados e invertidos
+    bool inRun;
+
+    // Termina a sequência de símbolos válidos atual, guardando os seus prefixos
+    void endRun();
+};
+
+// Converte as contagens para a outra representação (densa ou esparsa)
+ContextCounts convertCounts(const ContextCounts& counts, bool sparse);
+
+// Deriva as contagens de ordem k - 1 das de ordem k sem reler a sequência: cada
+// contexto de ordem k soma-se ao contexto sem o símbolo mais antigo, e a posição
+// k - 1 de cada sequência de símbolos válidos (que a ordem k não conta) vem de prefixes.
+// O resultado é igual ao de countContexts/countContextsSparse com k - 1
+ContextCounts lowerOrder(const ContextCounts& higher, const vector<RunPrefix>& prefixes, bool sparse);
+
+// A tabela densa ocupa 16 * 4^k bytes; a esparsa, no pior caso (um contexto novo
+// por posição e ocupação de 50%), 64 bytes por posição. Usa-se a esparsa quando a
+// densa seria maior, ou seja, quando ficaria maioritariamente vazia.
+bool preferSparse(size_t length, int k);
+
+#endif
@@ -0,0 +1,130 @@
+#include "Levenshtein.hpp"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Avança um bloco de 64 linhas uma coluna. Pv/Mv são os deltas verticais +1/-1
+// do bloco, eq os bits das linhas iguais ao símbolo do texto e hin o delta
+// horizontal na linha acima do bloco; devolve o delta horizontal na última linha.
+static inline int advanceBlock(uint64_t &Pv, uint64_t &Mv, uint64_t eq, uint64_t highBit, int hin) {
+    uint64_t Xv = eq | Mv;
+    if (hin < 0)
+        eq |= 1;
+    uint64_t Xh = (((eq & Pv) + Pv) ^ Pv) | eq;
+    uint64_t Ph = Mv | ~(Xh | Pv);
+    uint64_t Mh = Pv & Xh;
+
+    int hout = 0;
+    if (Ph & highBit)
+        hout = 1;
+    else if (Mh & highBit)
+        hout = -1;
+
+    Ph <<= 1;
+    Mh <<= 1;
+    if (hin < 0)
+        Mh |= 1;
+    else if (hin > 0)
+        Ph |= 1;
+    Pv = Mh | ~(Xv | Ph);
+    Mv = Ph & Xv;
+    return hout;
+}
+
+// Distância entre pattern (linhas) e text (colunas) limitada a maxDistance.
+//
+// Só são calculados os blocos que intersetam a faixa |i - j| <= maxDistance: um
+// bloco abaixo da faixa é inicializado com deltas verticais +1 quando a faixa o
+// alcança, e um bloco acima da faixa é abandonado, passando o seguinte a receber
+// hin = +1. Ambos os casos sobrestimam células cujo valor real já excede
+// maxDistance, pelo que as células com valor <= maxDistance ficam exatas.
+static int myersDistance(const string &pattern, const string &text, int maxDistance) {
+    const long m = pattern.size();
+    const long n = text.size();
+    if (labs(m - n) > maxDistance)
+        return -1;
+    if (m == 0 || n == 0)
+        return max(m, n);
+
+    // Alfabeto formado pelos símbolos (em maiúsculas) do padrão; os símbolos do
+    // texto que não ocorrem no padrão usam o índice extra, sem correspondências
+    array<int, 256> code;
+    code.fill(-1);
+    int symbols = 0;
+    for (char c : pattern) {
+        unsigned char u = toupper(static_cast<unsigned char>(c));
+        if (code[u] < 0)
+            code[u] = symbols++;
+    }
+    for (int c = 0; c < 256; c++) {
+        int upper = code[toupper(c)];
+        code[c] = upper < 0 ? symbols : upper;
+    }
+
+    const long blocks = (m + 63) / 64;
+    vector<uint64_t> peq((symbols + 1) * blocks, 0);
+    for (long i = 0; i < m; i++)
+        peq[code[static_cast<unsigned char>(pattern[i])] * blocks + i / 64] |= 1ULL << (i % 64);
+
+    auto rows = [m](long b) { return min(64L, m - b * 64); };
+
+    vector<uint64_t> Pv(blocks, ~0ULL), Mv(blocks, 0);
+    // Valor da última linha de cada bloco na coluna atual (coluna 0: D[i][0] = i)
+    vector<long> score(blocks);
+    for (long b = 0; b < blocks; b++)
+        score[b] = b * 64 + rows(b);
+
+    const long band = maxDistance;
+    long firstBlock = 0;
+    long lastBlock = min(blocks - 1, band / 64);
+
+    for (long j = 1; j <= n; j++) {
+        // Acrescenta os blocos cuja primeira linha entrou na faixa
+        while (lastBlock + 1 < blocks && (lastBlock + 1) * 64 + 1 <= j + band) {
+            lastBlock++;
+            Pv[lastBlock] = ~0ULL;
+            Mv[lastBlock] = 0;
+            score[lastBlock] = score[lastBlock - 1] + rows(lastBlock);
+        }
+
+        const uint64_t *eq = peq.data() + code[static_cast<unsigned char>(text[j - 1])] * blocks;
+        int hin = 1;
+        long lowest = LONG_MAX;
+        for (long b = firstBlock; b <= lastBlock; b++) {
+            hin = advanceBlock(Pv[b], Mv[b], eq[b], 1ULL << (rows(b) - 1), hin);
+            score[b] += hin;
+            // Os deltas verticais estão em {-1, 0, 1}: nenhuma célula do bloco é
+            // menor do que a última linha menos o número de linhas acima dela
+            lowest = min(lowest, score[b] - (rows(b) - 1));
+        }
+        if (lowest > band)
+            return -1;
+
+        // Abandona os blocos cuja última linha fica acima da faixa na próxima coluna;
+        // o último bloco calculado é mantido, porque contém a resposta no fim
+        while (firstBlock < lastBlock && firstBlock * 64 + rows(firstBlock) < j + 1 - band)
+            firstBlock++;
+    }
+
+    return score[blocks - 1] <= band ? score[blocks - 1] : -1;
+}
+
+int levenshteinDistance(const string &s1, const string &s2) {
+    // A distância é simétrica; o padrão é a sequência mais curta
+    const string &pattern = s1.size() <= s2.size() ? s1 : s2;
+    const string &text = s1.size() <= s2.size() ? s2 : s1;
+    return myersDistance(pattern, text, static_cast<int>(min<size_t>(INT_MAX, text.size())));
+}
+
+int levenshteinDistanceBounded(const string &s1, const string &s2, int maxDistance) {
+    if (maxDistance < 0)
+        return -1;
+    const string &pattern = s1.size() <= s2.size() ? s1 : s2;
+    const string &text = s1.size() <= s2.size() ? s2 : s1;
+    return myersDistance(pattern, text, maxDistance);
+}
@@ -0,0 +1,17 @@
+#ifndef LEVENSHTEIN_HPP
+#define LEVENSHTEIN_HPP
+
+#include <string>
+
+using namespace std;
+
+// Distância de edição (Levenshtein) sem distinção entre maiúsculas e minúsculas,
+// calculada com o algoritmo bit-paralelo de Myers/Hyyrö em blocos de 64 linhas:
+// O(ceil(m/64) * n) operações em vez das O(m * n) células da programação dinâmica.
+int levenshteinDistance(const string &s1, const string &s2);
+
+// Igual a levenshteinDistance, mas só calcula a faixa de diagonais |i - j| <= maxDistance
+// e desiste assim que a distância excede maxDistance; nesse caso devolve -1
+int levenshteinDistanceBounded(const string &s1, const string &s2, int maxDistance);
+
+#endif
@@ -1,23 +1,22 @@
 #include "MetaClass.hpp"
+#include "Nucleotide.hpp"
+#include "Stats.hpp"
 #include <fstream>
 #include <iostream>
 #include <cmath>
 #include <cctype>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 
 using namespace std;
 
-MetaClass::MetaClass() : k(0) {}
+// minSymbolCost só compensa com pelo menos este múltiplo das entradas do modelo em símbolos
+static const size_t MIN_COST_SCAN_FACTOR = 4;
 
-int MetaClass::charToIndex(char c) const {
-    c = toupper(c);
-    switch(c) {
-        case 'A': return 0;
-        case 'C': return 1;
-        case 'G': return 2;
-        case 'T': return 3;
-        default: return -1;
-    }
-}
+MetaClass::MetaClass()
+    : k(0), costsAlpha(0.0), mappedCounts(nullptr), mappedCountWidth(0), mappedCosts(nullptr), mappedEntries(0), sparseEntries(nullptr), sparseCapacity(0) {}
 
 unsigned long MetaClass::power4(int k) const {
     unsigned long res = 1;
@@ -26,12 +25,111 @@ unsigned long MetaClass::power4(int k) const {
     return res;
 }
 
-bool MetaClass::loadModel(const string &filename) {
+const void *MetaClass::countTable() const {
+    if (mappedCounts)
+        return mappedCounts;
+    return counts.empty() ? nullptr : counts.data();
+}
+
+int MetaClass::countWidth() const {
+    return mappedCounts ? mappedCountWidth : sizeof(int);
+}
+
+const float *MetaClass::costTable() const {
+    if (mappedCosts)
+        return mappedCosts;
+    return costs.empty() ? nullptr : costs.data();
+}
+
+size_t MetaClass::tableEntries() const {
+    if (mapping)
+        return mappedEntries;
+    return costs.empty() ? counts.size() : costs.size();
+}
+
+int MetaClass::alphabetSize() const {
+    if (sparseEntries)
+        return 4;
+    return tableEntries() / power4(k);
+}
+
+void MetaClass::reset() {
+    counts.clear();
+    costs.clear();
+    costsAlpha = 0.0;
+    mapping.reset();
+    mappedCounts = nullptr;
+    mappedCountWidth = 0;
+    mappedCosts = nullptr;
+    mappedEntries = 0;
+    sparseEntries = nullptr;
+    sparseCapacity = 0;
+    ownedSparse.reset();
+}
+
+bool MetaClass::loadModel(const string &filename, int order) {
+    reset();
     ifstream inFile(filename, ios::binary);
     if (!inFile) {
         cerr << "Erro ao abrir o ficheiro do modelo: " << filename << endl;
         return false;
     }
+    char magic[4];
+    inFile.read(magic, sizeof(magic));
+    if(!inFile) {
+        cerr << "Erro a ler k do ficheiro do modelo" << endl;
+        return false;
+    }
+    if (memcmp(magic, MODEL_MAGIC, sizeof(magic)) == 0 || memcmp(magic, BUNDLE_MAGIC, sizeof(magic)) == 0) {
+        inFile.close();
+        return loadMappedModel(filename, order);
+    }
+    inFile.seekg(0);
+    if (!loadLegacyModel(inFile, filename))
+        return false;
+    if (order >= 0 && order != k) {
+        cerr << "O modelo " << filename << " tem k = " << k << ", não " << order << endl;
+        return false;
+    }
+    return true;
+}
+
+vector<int> MetaClass::modelOrders(const string &filename) {
+    vector<int> orders;
+    // O mapeamento só lê as páginas tocadas: o diretório de um conjunto, o cabeçalho
+    // de um modelo ou o k inicial de um ficheiro antigo. O modelo em si só é
+    // validado (e lido) quando for carregado
+    MappedFile file;
+    if (!file.open(filename) || file.size() < sizeof(int)) {
+        cerr << "Erro ao abrir o ficheiro do modelo: " << filename << endl;
+        return orders;
+    }
+    const unsigned char *data = file.data();
+    if (memcmp(data, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) == 0) {
+        vector<BundleEntry> entries;
+        if (!readBundleDirectory(file, entries)) {
+            cerr << "Diretório inválido no conjunto de modelos: " << filename << endl;
+            return orders;
+        }
+        for (const BundleEntry &entry : entries)
+            orders.push_back(entry.k);
+    } else if (memcmp(data, MODEL_MAGIC, sizeof(MODEL_MAGIC)) == 0) {
+        ModelHeader header;
+        if (file.size() < sizeof(header)) {
+            cerr << "Cabeçalho inválido no modelo: " << filename << endl;
+            return orders;
+        }
+        memcpy(&header, data, sizeof(header));
+        orders.push_back(header.k);
+    } else {
+        int k;
+        memcpy(&k, data, sizeof(k));
+        orders.push_back(k);
+    }
+    return orders;
+}
+
+bool MetaClass::loadLegacyModel(ifstream &inFile, const string &filename) {
     inFile.read(reinterpret_cast<char*>(&k), sizeof(int));
     if(!inFile) {
         cerr << "Erro a ler k do ficheiro do modelo" << endl;
@@ -41,66 +139,629 @@ bool MetaClass::loadModel(const string &filename) {
     counts.resize(numContexts * 4);
     inFile.read(reinterpret_cast<char*>(counts.data()), counts.size() * sizeof(int));
     if(!inFile) {
-        cerr << "Erro a ler as contagens do modelo" << endl;
+        cerr << "Erro a ler as contagens do modelo " << filename << endl;
         return false;
     }
     inFile.close();
+    statsAdd(STAT_BYTES_READ, sizeof(int) + counts.size() * sizeof(int));
     return true;
 }
 
-double MetaClass::compressSequence(const string &seq, double a, int alphabetSize) const {
-    int n = seq.size();
-    if (n == 0) {
-        return 0.0;
+bool MetaClass::loadMappedModel(const string &filename, int order) {
+    auto file = make_shared<MappedFile>();
+    if (!file->open(filename) || file->size() < sizeof(ModelHeader)) {
+        cerr << "Erro ao mapear o ficheiro do modelo: " << filename << endl;
+        return false;
     }
-    
-    double cost = 0.0;
-    
-    int initialSymbols = min(n, k);
-    cost += initialSymbols * log2(alphabetSize);
-    
-    for (int i = k; i < n; i++) {
-        unsigned long index = 0;
-        bool validContext = true;
-        for (int j = i - k; j < i; j++) {
-            int idx = charToIndex(seq[j]);
-            if (idx < 0 || idx >= alphabetSize) {
-                validContext = false;
-                break;
-            }
-            index = index * alphabetSize + idx;
+
+    // Num conjunto o modelo escolhido ocupa [base, base + size) e é lido como um ficheiro próprio
+    const unsigned char *base = file->data();
+    size_t size = file->size();
+    if (memcmp(base, BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) == 0) {
+        vector<BundleEntry> entries;
+        if (!readBundleDirectory(*file, entries)) {
+            cerr << "Diretório inválido no conjunto de modelos: " << filename << endl;
+            return false;
         }
-        int sym = charToIndex(seq[i]);
-        if (sym < 0 || sym >= alphabetSize) {
-            validContext = false;
+        if (order < 0 && entries.size() != 1) {
+            cerr << "O ficheiro " << filename << " contém " << entries.size() << " modelos; indique o valor de k" << endl;
+            return false;
         }
-        if (!validContext) {
-            cost += log2(alphabetSize);
-            continue;
+        auto entry = find_if(entries.begin(), entries.end(), [order](const BundleEntry &e) {
+            return order < 0 || e.k == order;
+        });
+        if (entry == entries.end() || entry->size < sizeof(ModelHeader)) {
+            cerr << "O conjunto " << filename << " não tem o modelo de ordem k = " << order << endl;
+            return false;
         }
-        int countSymbol = counts[index * alphabetSize + sym];
+        base += entry->offset;
+        size = entry->size;
+    }
+
+    ModelHeader header;
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, MODEL_MAGIC, sizeof(header.magic)) != 0) {
+        cerr << "Cabeçalho inválido no modelo: " << filename << endl;
+        return false;
+    }
+    if (header.version != MODEL_FORMAT_VERSION) {
+        cerr << "Versão do modelo não suportada (" << header.version << "): " << filename << endl;
+        return false;
+    }
+    if (header.endianTag != MODEL_ENDIAN_TAG) {
+        cerr << "O modelo " << filename << " foi gravado numa máquina com outra ordem de bytes" << endl;
+        return false;
+    }
+    bool sparse = header.layout == LAYOUT_SPARSE_COUNTS;
+    if (!validModelTable(header, size)) {
+        cerr << "Cabeçalho inválido no modelo: " << filename << endl;
+        return false;
+    }
+
+    if (order >= 0 && header.k != order) {
+        cerr << "O modelo " << filename << " tem k = " << header.k << ", não " << order << endl;
+        return false;
+    }
+
+    const unsigned char *payload = base + header.payloadOffset;
+    if (header.layout == LAYOUT_DENSE_COUNTS) {
+        mappedCounts = payload;
+        mappedCountWidth = header.countWidth;
+    } else if (header.layout == LAYOUT_COMPILED) {
+        mappedCosts = reinterpret_cast<const float*>(payload);
+        costsAlpha = header.alpha;
+    } else if (sparse) {
+        sparseEntries = reinterpret_cast<const SparseEntry*>(payload);
+        sparseCapacity = header.numEntries;
+    } else {
+        cerr << "Organização de modelo desconhecida: " << filename << endl;
+        return false;
+    }
+    k = header.k;
+    mappedEntries = header.numEntries;
+    mapping = file;
+    statsAdd(STAT_BYTES_MAPPED, file->size());
+    return true;
+}
+
+// Percorre a sequência e, para cada posição i >= k, chama valid(i, contexto, símbolo)
+// se a posição tem contexto válido ou invalid(i) caso contrário.
+//
+// O contexto é mantido como uma janela deslizante: cada símbolo válido entra
+// pelos bits menos significativos e a máscara descarta o mais antigo.
+// validRun conta os símbolos válidos consecutivos já na janela; um símbolo
+// inválido reinicia-a e só após k símbolos válidos o contexto volta a ser usado.
+//
+// proceed(i) é chamada entre blocos de símbolos, com i a próxima posição a
+// visitar; se devolver false a passagem termina (devolve false nesse caso).
+//
+// As posições visitadas e as que não têm contexto válido (incluindo as k
+// primeiras) são somadas às estatísticas de pontuação.
+template <typename Valid, typename Invalid, typename Proceed>
+static bool forEachContext(const string &seq, int k, unsigned long mask, Valid valid, Invalid invalid,
+                           Proceed proceed) {
+    size_t n = seq.size();
+    unsigned long context = 0;
+    size_t validRun = 0;
+    size_t visited = 0;
+    uint64_t fallbacks = 0;
+
+    bool complete = forEachNucleotideBlock(seq.data(), n, [&](size_t begin, const uint8_t *codes, size_t length) {
+        if (!proceed(begin))
+            return false;
+        visited = begin + length;
+        for (size_t j = 0; j < length; j++) {
+            size_t i = begin + j;
+            int sym = codes[j];
+            if (i >= static_cast<size_t>(k)) {
+                if (sym == NUCLEOTIDE_INVALID || validRun < static_cast<size_t>(k)) {
+                    fallbacks++;
+                    invalid(i);
+                } else {
+                    valid(i, context, sym);
+                }
+            }
+            if (sym == NUCLEOTIDE_INVALID) {
+                validRun = 0;
+                context = 0;
+            } else {
+                context = ((context << 2) | sym) & mask;
+                validRun++;
+            }
+        }
+        return true;
+    });
+    statsAdd(STAT_SEQUENCES_SCORED, 1);
+    statsAdd(STAT_SYMBOLS_SCORED, visited);
+    statsAdd(STAT_CONTEXT_FALLBACKS, fallbacks + min(visited, static_cast<size_t>(k)));
+    return complete;
+}
+
+template <typename Valid, typename Invalid>
+static void forEachContext(const string &seq, int k, unsigned long mask, Valid valid, Invalid invalid) {
+    forEachContext(seq, k, mask, valid, invalid, [](size_t) { return true; });
+}
+
+// Chama visit(i, custo) para cada posição i >= k: as posições com contexto válido
+// custam symbolCost(contexto, símbolo), as restantes o custo uniforme
+template <typename SymbolCost, typename Visit>
+static void forEachCost(const string &seq, int k, unsigned long mask, double uniformCost,
+                        const SymbolCost &symbolCost, Visit visit) {
+    forEachContext(seq, k, mask,
+        [&](size_t i, unsigned long context, int sym) { visit(i, symbolCost(context, sym)); },
+        [&](size_t i) { visit(i, uniformCost); });
+}
+
+// Custo total da sequência; os primeiros k símbolos pagam o custo uniforme
+template <typename SymbolCost>
+static double rollingCost(const string &seq, int k, unsigned long mask, double uniformCost, const SymbolCost &symbolCost) {
+    double cost = 0.0;
+    size_t initialSymbols = min(seq.size(), static_cast<size_t>(k));
+    cost += initialSymbols * uniformCost;
+    forEachCost(seq, k, mask, uniformCost, symbolCost, [&cost](size_t, double symbolCost) {
+        cost += symbolCost;
+    });
+    return cost;
+}
+
+// Como rollingCost, mas abandona a sequência (devolvendo infinito) assim que o
+// custo acumulado mais minCost por cada posição em falta excede limitCost. Os
+// custos são somados pela mesma ordem, pelo que um resultado não abandonado é
+// igual ao de rollingCost
+template <typename SymbolCost>
+static double rollingCostBounded(const string &seq, int k, unsigned long mask, double uniformCost,
+                                 const SymbolCost &symbolCost, double minCost, double limitCost) {
+    double cost = 0.0;
+    size_t initialSymbols = min(seq.size(), static_cast<size_t>(k));
+    cost += initialSymbols * uniformCost;
+    const size_t n = seq.size();
+    bool complete = forEachContext(seq, k, mask,
+        [&](size_t, unsigned long context, int sym) { cost += symbolCost(context, sym); },
+        [&](size_t) { cost += uniformCost; },
+        [&](size_t i) {
+            size_t next = max(i, static_cast<size_t>(k));
+            size_t remaining = n > next ? n - next : 0;
+            return cost + remaining * minCost <= limitCost;
+        });
+    if (!complete)
+        statsAdd(STAT_SEQUENCES_ABANDONED, 1);
+    return complete ? cost : numeric_limits<double>::infinity();
+}
+
+// Custo com a tabela densa de contagens; CountT é a largura das contagens no modelo
+// (uint8_t/uint16_t saturadas ou int). Os totais são somados em int, pelo que o
+// resultado é igual ao do modelo de 32 bits sempre que nenhuma contagem saturou.
+template <typename CountT>
+struct DenseCost {
+    const CountT *table;
+    double a;
+    int alphabetSize;
+
+    double operator()(unsigned long context, int sym) const {
+        const CountT *row = table + context * alphabetSize;
         int sumContext = 0;
         for (int s = 0; s < alphabetSize; s++) {
-            sumContext += counts[index * alphabetSize + s];
+            sumContext += row[s];
         }
+        double prob = (row[sym] + a) / (sumContext + a * alphabetSize);
+        return -log2(prob);
+    }
+};
+
+// Custo com a tabela esparsa; um contexto ausente equivale a uma linha de
+// contagens a zero na tabela densa
+struct SparseCost {
+    const SparseEntry *entries;
+    uint64_t slotMask;
+    double a;
+    int alphabetSize;
+
+    double operator()(unsigned long context, int sym) const {
+        const SparseEntry *entry = sparseFind(entries, slotMask, context);
+        int countSymbol = entry ? entry->counts[sym] : 0;
+        int sumContext = entry ? entry->total : 0;
         double prob = (countSymbol + a) / (sumContext + a * alphabetSize);
-        cost += -log2(prob);
+        return -log2(prob);
+    }
+};
+
+// Custo lido da tabela de um modelo compilado
+struct CompiledCost {
+    const float *costs;
+    int alphabetSize;
+
+    double operator()(unsigned long context, int sym) const {
+        return static_cast<double>(costs[context * alphabetSize + sym]);
+    }
+};
+
+// Contagens (símbolo, total do contexto) lidas da tabela densa
+template <typename CountT>
+struct DenseCounts {
+    const CountT *table;
+    int alphabetSize;
+
+    void operator()(unsigned long context, int sym, int &countSymbol, int &sumContext) const {
+        const CountT *row = table + context * alphabetSize;
+        sumContext = 0;
+        for (int s = 0; s < alphabetSize; s++) {
+            sumContext += row[s];
+        }
+        countSymbol = row[sym];
+    }
+};
+
+// Contagens lidas da tabela esparsa; um contexto ausente tem contagens a zero
+struct SparseCounts {
+    const SparseEntry *entries;
+    uint64_t slotMask;
+
+    void operator()(unsigned long context, int sym, int &countSymbol, int &sumContext) const {
+        const SparseEntry *entry = sparseFind(entries, slotMask, context);
+        countSymbol = entry ? entry->counts[sym] : 0;
+        sumContext = entry ? entry->total : 0;
+    }
+};
+
+// Preenche costs com -log2(P(s|c)) para todos os contextos da tabela densa
+template <typename CountT>
+static void compileCosts(const CountT *table, unsigned long numContexts, int symbols, double a, vector<float> &costs) {
+    costs.resize(numContexts * symbols);
+    for (unsigned long c = 0; c < numContexts; c++) {
+        const CountT *row = table + c * symbols;
+        // Total do contexto calculado uma única vez para os seus símbolos
+        int sumContext = 0;
+        for (int s = 0; s < symbols; s++) {
+            sumContext += row[s];
+        }
+        double denominator = sumContext + a * symbols;
+        for (int s = 0; s < symbols; s++) {
+            costs[c * symbols + s] = static_cast<float>(-log2((row[s] + a) / denominator));
+        }
+    }
+}
+
+template <typename Visit>
+double MetaClass::withSymbolCost(double a, int alphabetSize, Visit visit) const {
+    const float *compiled = costTable();
+    const void *table = countTable();
+
+    if (sparseEntries)
+        return visit(SparseCost{sparseEntries, sparseCapacity - 1, a, alphabetSize});
+
+    if (compiled && (!table || a == costsAlpha))
+        return visit(CompiledCost{compiled, alphabetSize});
+
+    switch (countWidth()) {
+        case 1: return visit(DenseCost<uint8_t>{static_cast<const uint8_t*>(table), a, alphabetSize});
+        case 2: return visit(DenseCost<uint16_t>{static_cast<const uint16_t*>(table), a, alphabetSize});
+        default: return visit(DenseCost<int>{static_cast<const int*>(table), a, alphabetSize});
     }
-    return cost;
+}
+
+template <typename Visit>
+void MetaClass::withContextCounts(int alphabetSize, Visit visit) const {
+    if (sparseEntries) {
+        visit(SparseCounts{sparseEntries, sparseCapacity - 1});
+        return;
+    }
+    const void *table = countTable();
+    switch (countWidth()) {
+        case 1: visit(DenseCounts<uint8_t>{static_cast<const uint8_t*>(table), alphabetSize}); break;
+        case 2: visit(DenseCounts<uint16_t>{static_cast<const uint16_t*>(table), alphabetSize}); break;
+        default: visit(DenseCounts<int>{static_cast<const int*>(table), alphabetSize}); break;
+    }
+}
+
+double MetaClass::compressSequence(const string &seq, double a, int alphabetSize) const {
+    if (seq.empty()) {
+        return 0.0;
+    }
+
+    const double uniformCost = log2(alphabetSize);
+    const unsigned long mask = power4(k) - 1;
+    return withSymbolCost(a, alphabetSize, [&](const auto &symbolCost) {
+        return rollingCost(seq, k, mask, uniformCost, symbolCost);
+    });
+}
+
+vector<double> MetaClass::positionCosts(const string &seq, double a) const {
+    vector<double> costs;
+    if (seq.size() <= static_cast<size_t>(k))
+        return costs;
+    costs.resize(seq.size() - k);
+
+    const int symbols = alphabetSize();
+    const double uniformCost = log2(symbols);
+    const unsigned long mask = power4(k) - 1;
+    double *out = costs.data();
+    const size_t first = k;
+    withSymbolCost(a, symbols, [&](const auto &symbolCost) {
+        forEachCost(seq, k, mask, uniformCost, symbolCost, [out, first](size_t i, double cost) {
+            out[i - first] = cost;
+        });
+        return 0.0;
+    });
+    return costs;
 }
 
 double MetaClass::computeNRC(const string &seq, double a) const {
     int n = seq.size();
     if(n == 0) return 0.0;
-    int alphabetSize = counts.size() / power4(k);
-    double cost = compressSequence(seq, a, alphabetSize);
-    return cost / (log2(alphabetSize) * n);
+    int symbols = alphabetSize();
+    double cost = compressSequence(seq, a, symbols);
+    return cost / (log2(symbols) * n);
+}
+
+double MetaClass::computeNRCBounded(const string &seq, double a, double limit, double minCost) const {
+    if (seq.empty())
+        return 0.0;
+    const int symbols = alphabetSize();
+    const double uniformCost = log2(symbols);
+    const unsigned long mask = power4(k) - 1;
+    // Margem relativa para os erros de arredondamento da soma: só é abandonada
+    // uma sequência cujo NRC final é seguramente maior do que limit
+    const double limitCost = limit * uniformCost * seq.size() * (1.0 + 1e-6);
+    double cost = withSymbolCost(a, symbols, [&](const auto &symbolCost) {
+        return rollingCostBounded(seq, k, mask, uniformCost, symbolCost, minCost, limitCost);
+    });
+    return cost / (uniformCost * seq.size());
+}
+
+// Menor custo -log2((contagem + a) / (total + a * símbolos)) das linhas da tabela densa
+template <typename CountT>
+static double minDenseCost(const CountT *table, unsigned long numContexts, int symbols, double a) {
+    double best = 0.0;
+    for (unsigned long c = 0; c < numContexts; c++) {
+        const CountT *row = table + c * symbols;
+        int sumContext = 0, maxCount = 0;
+        for (int s = 0; s < symbols; s++) {
+            sumContext += row[s];
+            maxCount = max(maxCount, static_cast<int>(row[s]));
+        }
+        best = max(best, (maxCount + a) / (sumContext + a * symbols));
+    }
+    return best > 0.0 ? -log2(best) : numeric_limits<double>::infinity();
+}
+
+double MetaClass::minSymbolCost(double a) const {
+    const int symbols = alphabetSize();
+    // As posições sem contexto válido custam sempre log2(|alfabeto|)
+    double best = log2(symbols);
+    const float *compiled = costTable();
+    const void *table = countTable();
+
+    if (sparseEntries) {
+        for (uint64_t slot = 0; slot < sparseCapacity; slot++) {
+            const SparseEntry &entry = sparseEntries[slot];
+            if (entry.key == 0)
+                continue;
+            uint32_t maxCount = *max_element(entry.counts, entry.counts + symbols);
+            best = min(best, -log2((maxCount + a) / (entry.total + a * symbols)));
+        }
+        return best;
+    }
+    if (compiled && (!table || a == costsAlpha))
+        return min(best, static_cast<double>(*min_element(compiled, compiled + tableEntries())));
+
+    unsigned long numContexts = power4(k);
+    switch (countWidth()) {
+        case 1: return min(best, minDenseCost(static_cast<const uint8_t*>(table), numContexts, symbols, a));
+        case 2: return min(best, minDenseCost(static_cast<const uint16_t*>(table), numContexts, symbols, a));
+        default: return min(best, minDenseCost(static_cast<const int*>(table), numContexts, symbols, a));
+    }
+}
+
+size_t MetaClass::minSymbolCostEntries() const {
+    return sparseEntries ? sparseCapacity : tableEntries();
+}
+
+bool MetaClass::minSymbolCostPays(size_t symbols) const {
+    return symbols / MIN_COST_SCAN_FACTOR > minSymbolCostEntries();
+}
+
+vector<double> MetaClass::computeNRCs(const string &seq, const vector<double> &alphas) const {
+    vector<double> nrcs(alphas.size(), 0.0);
+    if (seq.empty())
+        return nrcs;
+    // Sem contagens só há custos para um alpha; cada valor é calculado à parte
+    if (!hasCounts()) {
+        for (size_t j = 0; j < alphas.size(); j++)
+            nrcs[j] = computeNRC(seq, alphas[j]);
+        return nrcs;
+    }
+
+    const int symbols = alphabetSize();
+    const double uniformCost = log2(symbols);
+    const unsigned long mask = power4(k) - 1;
+    const size_t numAlphas = alphas.size();
+
+    // Os denominadores a * |alfabeto| não dependem da posição
+    vector<double> alphaTotals(numAlphas);
+    for (size_t j = 0; j < numAlphas; j++)
+        alphaTotals[j] = alphas[j] * symbols;
+
+    // Os custos são acumulados pela mesma ordem que em rollingCost, pelo que
+    // cada total é igual ao de compressSequence com esse alpha
+    vector<double> costs(numAlphas, min(seq.size(), static_cast<size_t>(k)) * uniformCost);
+    double *cost = costs.data();
+    const double *alpha = alphas.data();
+    const double *alphaTotal = alphaTotals.data();
+    withContextCounts(symbols, [&](const auto &contextCounts) {
+        forEachContext(seq, k, mask,
+            [&](size_t, unsigned long context, int sym) {
+                int countSymbol, sumContext;
+                contextCounts(context, sym, countSymbol, sumContext);
+                for (size_t j = 0; j < numAlphas; j++)
+                    cost[j] += -log2((countSymbol + alpha[j]) / (sumContext + alphaTotal[j]));
+            },
+            [&](size_t) {
+                for (size_t j = 0; j < numAlphas; j++)
+                    cost[j] += uniformCost;
+            });
+    });
+
+    for (size_t j = 0; j < numAlphas; j++)
+        nrcs[j] = costs[j] / (log2(symbols) * seq.size());
+    return nrcs;
+}
+
+MixtureNRC MetaClass::computeMixtureNRC(const vector<const MetaClass *> &models, const string &seq, double a,
+                                        double gamma) {
+    const size_t numModels = models.size();
+    MixtureNRC result{vector<double>(numModels, 0.0), 0.0};
+    if (seq.empty() || numModels == 0)
+        return result;
+
+    const int symbols = models[0]->alphabetSize();
+    const double uniformCost = log2(symbols);
+    const size_t n = seq.size();
+    int kMax = 0;
+    for (const MetaClass *model : models)
+        kMax = max(kMax, model->k);
+    const unsigned long mask = models[0]->power4(kMax) - 1;
+
+    // Os custos de cada modelo são somados pela mesma ordem que em rollingCost,
+    // pelo que cada total é igual ao de compressSequence
+    vector<double> totals(numModels);
+    for (size_t m = 0; m < numModels; m++)
+        totals[m] = min(n, static_cast<size_t>(models[m]->k)) * uniformCost;
+    vector<double> weights(numModels, 1.0 / numModels);
+    vector<double> probs(numModels);
+    double mixedCost = 0.0;
+
+    // Em cada bloco, contexts[j] e runs[j] são o contexto de ordem kMax e o
+    // número de símbolos válidos consecutivos antes do símbolo j; os custos de
+    // cada modelo são calculados para o bloco inteiro e só depois misturados
+    vector<unsigned long> contexts;
+    vector<size_t> runs;
+    vector<vector<double>> costs(numModels);
+    unsigned long context = 0;
+    size_t validRun = 0;
+    forEachNucleotideBlock(seq.data(), n, [&](size_t begin, const uint8_t *codes, size_t length) {
+        contexts.resize(length);
+        runs.resize(length);
+        for (size_t j = 0; j < length; j++) {
+            contexts[j] = context;
+            runs[j] = validRun;
+            if (codes[j] == NUCLEOTIDE_INVALID) {
+                validRun = 0;
+                context = 0;
+            } else {
+                context = ((context << 2) | codes[j]) & mask;
+                validRun++;
+            }
+        }
+
+        for (size_t m = 0; m < numModels; m++) {
+            const MetaClass &model = *models[m];
+            const size_t order = model.k;
+            const unsigned long orderMask = model.power4(model.k) - 1;
+            costs[m].resize(length);
+            double *cost = costs[m].data();
+            model.withSymbolCost(a, symbols, [&](const auto &symbolCost) {
+                double total = totals[m];
+                for (size_t j = 0; j < length; j++) {
+                    int sym = codes[j];
+                    if (sym == NUCLEOTIDE_INVALID || runs[j] < order)
+                        cost[j] = uniformCost;
+                    else
+                        cost[j] = symbolCost(contexts[j] & orderMask, sym);
+                    if (begin + j >= order)
+                        total += cost[j];
+                }
+                totals[m] = total;
+                return 0.0;
+            });
+        }
+
+        for (size_t j = 0; j < length; j++) {
+            double mixed = 0.0;
+            for (size_t m = 0; m < numModels; m++) {
+                probs[m] = exp2(-costs[m][j]);
+                mixed += weights[m] * probs[m];
+            }
+            mixedCost -= log2(mixed);
+            double sum = 0.0;
+            for (size_t m = 0; m < numModels; m++) {
+                weights[m] = (gamma == 1.0 ? weights[m] : pow(weights[m], gamma)) * probs[m];
+                sum += weights[m];
+            }
+            for (size_t m = 0; m < numModels; m++)
+                weights[m] /= sum;
+        }
+        return true;
+    });
+    statsAdd(STAT_SEQUENCES_SCORED, 1);
+    statsAdd(STAT_SYMBOLS_SCORED, n);
+
+    for (size_t m = 0; m < numModels; m++)
+        result.nrcs[m] = totals[m] / (log2(symbols) * n);
+    result.mixed = mixedCost / (log2(symbols) * n);
+    return result;
 }
 
 void MetaClass::setCounts(const vector<int> &counts) {
+    reset();
     this->counts = counts;
 }
 
+void MetaClass::setSparseCounts(SparseTable table) {
+    reset();
+    ownedSparse = make_shared<const SparseTable>(move(table));
+    sparseEntries = ownedSparse->data();
+    sparseCapacity = ownedSparse->capacity();
+}
+
 void MetaClass::setK(int k) {
     this->k = k;
-}
\ No newline at end of file
+}
+
+bool MetaClass::compile(double a) {
+    const void *table = countTable();
+    if (sparseEntries) {
+        cerr << "Os modelos esparsos não podem ser compilados numa tabela densa de custos" << endl;
+        return false;
+    }
+    if (!table) {
+        cerr << "Não há contagens para compilar o modelo" << endl;
+        return false;
+    }
+    int symbols = alphabetSize();
+    unsigned long numContexts = power4(k);
+    switch (countWidth()) {
+        case 1: compileCosts(static_cast<const uint8_t*>(table), numContexts, symbols, a, costs); break;
+        case 2: compileCosts(static_cast<const uint16_t*>(table), numContexts, symbols, a, costs); break;
+        default: compileCosts(static_cast<const int*>(table), numContexts, symbols, a, costs); break;
+    }
+    costsAlpha = a;
+    return true;
+}
+
+bool MetaClass::saveCompiled(const string &filename) const {
+    const float *compiled = costTable();
+    if (!compiled) {
+        cerr << "O modelo não está compilado" << endl;
+        return false;
+    }
+    try {
+        ModelHeader header = makeModelHeader(LAYOUT_COMPILED, sizeof(float), k, tableEntries(), costsAlpha);
+        writeModelFile(filename, header, compiled);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+bool MetaClass::isCompiled() const {
+    return costTable() != nullptr;
+}
+
+double MetaClass::compiledAlpha() const {
+    return costsAlpha;
+}
+
+bool MetaClass::hasCounts() const {
+    return sparseEntries != nullptr || countTable() != nullptr;
+}
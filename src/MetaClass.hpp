@@ -1,11 +1,20 @@
 #ifndef METACLASS_HPP
 #define METACLASS_HPP
 
+#include <memory>
 #include <string>
 #include <vector>
+#include "ModelFile.hpp"
+#include "SparseTable.hpp"
 
 using namespace std;
 
+// Resultado de MetaClass::computeMixtureNRC
+struct MixtureNRC {
+    vector<double> nrcs;       // NRC de cada modelo, igual ao de computeNRC
+    double mixed;              // NRC da mistura
+};
+
 class MetaClass {
 public:
     int k;                     
@@ -13,19 +22,109 @@ public:
 
     MetaClass();
     
-    bool loadModel(const string &filename);
+    // Carrega um modelo de contagens (denso ou esparso) ou compilado. Os ficheiros no formato
+    // versionado são mapeados em memória e usados sem cópia; os ficheiros
+    // antigos (k seguido das contagens) são lidos para memória própria.
+    // Num conjunto de modelos (models_generator -k a-b) é usado o modelo de ordem
+    // order; se order for -1 o conjunto tem de ter um único modelo
+    bool loadModel(const string &filename, int order = -1);
+
+    // Ordens k disponíveis no ficheiro (uma só, exceto nos conjuntos); vazio em caso de erro
+    static vector<int> modelOrders(const string &filename);
     
     double compressSequence(const string &seq, double a, int alphabetSize) const;
     
     double computeNRC(const string &seq, double a) const;
 
+    // Como computeNRC, mas desiste da sequência (devolvendo infinito) assim que
+    // o custo já acumulado, somado a minCost por cada posição em falta, garante
+    // que o NRC final excede limit. minCost deve ser minSymbolCost(a)
+    double computeNRCBounded(const string &seq, double a, double limit, double minCost) const;
+
+    // Menor custo em bits que uma posição pode ter com o alpha dado (limite
+    // inferior usado por computeNRCBounded); percorre o modelo inteiro
+    double minSymbolCost(double a) const;
+
+    // Número de entradas que minSymbolCost percorre, i.e. o custo de o calcular
+    size_t minSymbolCostEntries() const;
+
+    // Se pontuar symbols posições compensa o custo de minSymbolCost: só quando há
+    // bastante mais posições do que entradas no modelo
+    bool minSymbolCostPays(size_t symbols) const;
+
+    // Custo em bits de cada posição i >= k da sequência (elemento i - k), pelas
+    // mesmas regras de compressSequence
+    vector<double> positionCosts(const string &seq, double a) const;
+
+    // NRC da sequência para cada alpha de alphas, com uma única passagem: as
+    // contagens de cada posição são lidas uma vez e avaliadas para todos os alphas.
+    // Cada valor é igual ao de computeNRC com o alpha correspondente
+    vector<double> computeNRCs(const string &seq, const vector<double> &alphas) const;
+
+    // Pontua seq com vários modelos (de ordens possivelmente diferentes) numa
+    // única passagem: o contexto da maior ordem é mantido uma vez e o de cada
+    // modelo são os seus k símbolos mais recentes. As probabilidades do símbolo
+    // são combinadas com pesos atualizados a cada posição,
+    // w_m <- w_m^gamma * P_m(símbolo), normalizados; gamma < 1 esquece o passado
+    // e deixa a mistura mudar de modelo ao longo da sequência
+    static MixtureNRC computeMixtureNRC(const vector<const MetaClass *> &models, const string &seq, double a,
+                                        double gamma);
+
     void setCounts(const vector<int> &counts);
 
+    // Usa uma tabela esparsa construída em memória (ver countContextsSparse)
+    void setSparseCounts(SparseTable table);
+
     void setK(int k);
+
+    // Materializa o custo -log2(P(s|c)) de cada par (contexto, símbolo) para o
+    // alpha dado; a partir daí as sequências pontuadas com esse alpha usam a tabela
+    bool compile(double a);
+
+    bool saveCompiled(const string &filename) const;
+
+    bool isCompiled() const;
+
+    double compiledAlpha() const;
+
+    // Indica se o modelo tem contagens (e não apenas custos compilados), i.e. se
+    // pode ser avaliado com qualquer alpha
+    bool hasCounts() const;
     
 private:
-    int charToIndex(char c) const;
+    vector<float> costs;       // custos por (contexto, símbolo) do modelo compilado
+    double costsAlpha;
+
+    // Tabelas lidas diretamente do ficheiro mapeado (nullptr se não existirem)
+    shared_ptr<MappedFile> mapping;
+    const void *mappedCounts;
+    int mappedCountWidth;              // bytes por contagem do modelo denso mapeado (1, 2 ou 4)
+    const float *mappedCosts;
+    size_t mappedEntries;
+
+    // Modelo esparso, mapeado ou em ownedSparse
+    const SparseEntry *sparseEntries;
+    uint64_t sparseCapacity;
+    shared_ptr<const SparseTable> ownedSparse;
+
+    const void *countTable() const;
+    int countWidth() const;
+    const float *costTable() const;
+    size_t tableEntries() const;
+    void reset();
+    bool loadLegacyModel(ifstream &inFile, const string &filename);
+    bool loadMappedModel(const string &filename, int order);
+
+    // Chama visit com o functor de custo (contexto, símbolo) adequado ao modelo carregado
+    template <typename Visit>
+    double withSymbolCost(double a, int alphabetSize, Visit visit) const;
+
+    // Chama visit com o functor que devolve as contagens (símbolo, total) de um contexto
+    template <typename Visit>
+    void withContextCounts(int alphabetSize, Visit visit) const;
+
     unsigned long power4(int k) const;
+    int alphabetSize() const;
 };
 
-#endif
\ No newline at end of file
+#endif
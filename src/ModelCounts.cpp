@@ -0,0 +1,112 @@
+#include "ModelCounts.hpp"
+#include "Stats.hpp"
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+// Converte as contagens para um tipo mais estreito, saturando no máximo do tipo;
+// devolve em saturated o número de contagens que foram truncadas
+template <typename CountT>
+static vector<CountT> narrowCounts(const vector<int>& counts, size_t& saturated) {
+    const int maxCount = numeric_limits<CountT>::max();
+    vector<CountT> narrow(counts.size());
+    saturated = 0;
+    for (size_t i = 0; i < counts.size(); i++) {
+        if (counts[i] > maxCount) {
+            narrow[i] = maxCount;
+            saturated++;
+        } else {
+            narrow[i] = static_cast<CountT>(counts[i]);
+        }
+    }
+    return narrow;
+}
+
+// Grava o modelo (cabeçalho versionado seguido das contagens), com contagens de
+// countBits bits (8 e 16 saturam)
+static void writeModel(const ModelSink& write, int k, const vector<int>& counts, int countBits) {
+    size_t saturated = 0;
+    if (countBits == 8) {
+        vector<uint8_t> narrow = narrowCounts<uint8_t>(counts, saturated);
+        write(makeModelHeader(LAYOUT_DENSE_COUNTS, 1, k, narrow.size()), narrow.data());
+    } else if (countBits == 16) {
+        vector<uint16_t> narrow = narrowCounts<uint16_t>(counts, saturated);
+        write(makeModelHeader(LAYOUT_DENSE_COUNTS, 2, k, narrow.size()), narrow.data());
+    } else {
+        write(makeModelHeader(LAYOUT_DENSE_COUNTS, sizeof(int), k, counts.size()), counts.data());
+    }
+    if (saturated > 0)
+        cerr << "Aviso: " << saturated << " contagens de k = " << k << " saturaram em " << countBits << " bits" << endl;
+}
+
+// Grava o modelo esparso (cabeçalho seguido da tabela de dispersão)
+static void writeSparseModel(const ModelSink& write, int k, const SparseTable& table) {
+    write(makeModelHeader(LAYOUT_SPARSE_COUNTS, sizeof(SparseEntry), k, table.capacity()), table.data());
+}
+
+void writeCounts(const ModelSink& write, const ContextCounts& counts, int countBits) {
+    if (counts.sparse) {
+        // Só chega aqui quando a escolha automática deu a tabela esparsa (-sparse com
+        // -w 8/16 é recusado à partida)
+        if (countBits != 32)
+            cerr << "Aviso: -w " << countBits << " ignorado para k = " << counts.k
+                 << ": o modelo é esparso e as suas contagens têm sempre 32 bits" << endl;
+        writeSparseModel(write, counts.k, counts.table);
+        return;
+    }
+    writeModel(write, counts.k, counts.dense, countBits);
+}
+
+// Valida o modelo que ocupa [base, base + size) e devolve a sua tabela de contagens
+static CountsView countTable(const unsigned char* base, uint64_t size, const string& filename) {
+    ModelHeader header;
+    if (size < sizeof(header))
+        throw runtime_error("Cabeçalho inválido no modelo: " + filename);
+    memcpy(&header, base, sizeof(header));
+    if (memcmp(header.magic, MODEL_MAGIC, sizeof(header.magic)) != 0)
+        throw runtime_error("Cabeçalho inválido no modelo: " + filename);
+    if (header.version != MODEL_FORMAT_VERSION || header.endianTag != MODEL_ENDIAN_TAG)
+        throw runtime_error("Versão ou ordem de bytes não suportada no modelo: " + filename);
+    if (header.layout == LAYOUT_COMPILED)
+        throw runtime_error("O modelo " + filename + " está compilado e já não tem contagens");
+
+    if (header.k < 1 || !validModelTable(header, size))
+        throw runtime_error("Cabeçalho inválido no modelo: " + filename);
+    const bool sparse = header.layout == LAYOUT_SPARSE_COUNTS;
+    return CountsView{header.k, sparse, header.countWidth, base + header.payloadOffset, header.numEntries};
+}
+
+// Tabela de um ficheiro antigo (um int com k seguido das 4^k x 4 contagens int),
+// vista como um modelo denso de 4 bytes por contagem, como em MetaClass
+static CountsView legacyCountTable(const unsigned char* data, uint64_t size, const string& filename) {
+    int k;
+    if (size < sizeof(k))
+        throw runtime_error("Erro a ler k do ficheiro do modelo " + filename);
+    memcpy(&k, data, sizeof(k));
+    if (k < 1 || k > 30 || power4(k) * 4 > (size - sizeof(k)) / sizeof(int))
+        throw runtime_error("Erro a ler as contagens do modelo " + filename);
+    return CountsView{k, false, sizeof(int), data + sizeof(k), power4(k) * 4};
+}
+
+void MappedCounts::open(const string& filename) {
+    orders.clear();
+    if (!file.open(filename))
+        throw runtime_error("Erro ao mapear o ficheiro do modelo: " + filename);
+    statsAdd(STAT_BYTES_MAPPED, file.size());
+
+    bundle = file.size() >= sizeof(BUNDLE_MAGIC) && memcmp(file.data(), BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC)) == 0;
+    if (!bundle) {
+        bool versioned = file.size() >= sizeof(MODEL_MAGIC) && memcmp(file.data(), MODEL_MAGIC, sizeof(MODEL_MAGIC)) == 0;
+        orders.push_back(versioned ? countTable(file.data(), file.size(), filename)
+                                   : legacyCountTable(file.data(), file.size(), filename));
+        return;
+    }
+    vector<BundleEntry> entries;
+    if (!readBundleDirectory(file, entries))
+        throw runtime_error("Diretório inválido no conjunto de modelos: " + filename);
+    for (const BundleEntry& entry : entries)
+        orders.push_back(countTable(file.data() + entry.offset, entry.size, filename));
+}
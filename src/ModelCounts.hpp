@@ -0,0 +1,32 @@
+#ifndef MODELCOUNTS_HPP
+#define MODELCOUNTS_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "ContextCounter.hpp"
+#include "ModelFile.hpp"
+
+using namespace std;
+
+// Destino de um modelo (cabeçalho e tabela): um ficheiro próprio ou um conjunto
+using ModelSink = function<void(const ModelHeader&, const void*)>;
+
+// Grava as contagens de uma ordem na representação em que estão; as densas
+// ficam com countBits bits por contagem (8 e 16 saturam). As esparsas têm sempre
+// 32 bits: com outro countBits é emitido um aviso
+void writeCounts(const ModelSink& write, const ContextCounts& counts, int countBits);
+
+// Contagens de um modelo (no formato versionado ou antigo) ou de um conjunto de
+// modelos, mapeadas em memória e lidas sem cópia; as vistas só são válidas
+// enquanto o ficheiro estiver aberto
+struct MappedCounts {
+    MappedFile file;
+    bool bundle = false;
+    vector<CountsView> orders;  // pela ordem do ficheiro (num conjunto, da ordem mais alta para a mais baixa)
+
+    // Lança runtime_error se o ficheiro não for um modelo de contagens
+    void open(const string& filename);
+};
+
+#endif
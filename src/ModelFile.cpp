@@ -0,0 +1,171 @@
+#include "ModelFile.hpp"
+#include "SparseTable.hpp"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+ModelHeader makeModelHeader(ModelLayout layout, uint8_t countWidth, int k, uint64_t numEntries, double alpha) {
+    ModelHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MODEL_MAGIC, sizeof(header.magic));
+    header.version = MODEL_FORMAT_VERSION;
+    header.endianTag = MODEL_ENDIAN_TAG;
+    header.countWidth = countWidth;
+    header.layout = layout;
+    header.k = k;
+    header.numEntries = numEntries;
+    header.alpha = alpha;
+    header.payloadOffset = (sizeof(ModelHeader) + MODEL_PAYLOAD_ALIGNMENT - 1) / MODEL_PAYLOAD_ALIGNMENT * MODEL_PAYLOAD_ALIGNMENT;
+    return header;
+}
+
+bool validModelTable(const ModelHeader &header, uint64_t size) {
+    bool valid;
+    if (header.layout == LAYOUT_SPARSE_COUNTS) {
+        valid = header.k >= 0 && header.k <= 31 && header.countWidth == sizeof(SparseEntry) &&
+                header.numEntries > 0 && (header.numEntries & (header.numEntries - 1)) == 0;
+    } else if (header.layout == LAYOUT_DENSE_COUNTS || header.layout == LAYOUT_COMPILED) {
+        // 4^k contextos x 4 entradas: com k = 31 seriam 2^64, que não cabem em 64 bits
+        valid = header.k >= 0 && header.k <= 30 && header.numEntries == uint64_t(1) << (2 * header.k + 2) &&
+                (header.layout == LAYOUT_COMPILED ? header.countWidth == sizeof(float)
+                                                  : header.countWidth == 1 || header.countWidth == 2 || header.countWidth == 4);
+    } else {
+        valid = false;
+    }
+    // Comparado por divisão para que numEntries * countWidth não transborde
+    return valid && header.payloadOffset % MODEL_PAYLOAD_ALIGNMENT == 0 && header.payloadOffset <= size &&
+           header.numEntries <= (size - header.payloadOffset) / header.countWidth;
+}
+
+void writeModelFile(const string &filename, const ModelHeader &header, const void *payload) {
+    ofstream outFile(filename, ios::binary);
+    if (!outFile)
+        throw runtime_error("Erro ao abrir " + filename + " para escrita");
+
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    static const char zeros[MODEL_PAYLOAD_ALIGNMENT] = {};
+    outFile.write(zeros, header.payloadOffset - sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(payload), header.numEntries * header.countWidth);
+    if (!outFile)
+        throw runtime_error("Erro a escrever o modelo em " + filename);
+}
+
+// Escreve os zeros que faltam para alinhar a posição atual do ficheiro
+static void padTo(ofstream &outFile, uint64_t alignment) {
+    static const char zeros[MODEL_PAYLOAD_ALIGNMENT] = {};
+    uint64_t position = outFile.tellp();
+    outFile.write(zeros, (alignment - position % alignment) % alignment);
+}
+
+BundleWriter::BundleWriter(const string &filename, uint32_t count)
+    : filename(filename), outFile(filename, ios::binary), count(count) {
+    if (!outFile)
+        throw runtime_error("Erro ao abrir " + filename + " para escrita");
+    // O cabeçalho e o diretório são reservados agora e preenchidos em close()
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    vector<BundleEntry> directory(count, BundleEntry{});
+    outFile.write(reinterpret_cast<const char*>(directory.data()), count * sizeof(BundleEntry));
+}
+
+void BundleWriter::add(const ModelHeader &header, const void *payload) {
+    if (entries.size() >= count)
+        throw runtime_error("Modelos a mais para o conjunto " + filename);
+    padTo(outFile, MODEL_PAYLOAD_ALIGNMENT);
+    BundleEntry entry{};
+    entry.k = header.k;
+    entry.offset = outFile.tellp();
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    padTo(outFile, MODEL_PAYLOAD_ALIGNMENT);
+    outFile.write(reinterpret_cast<const char*>(payload), header.numEntries * header.countWidth);
+    entry.size = header.payloadOffset + header.numEntries * header.countWidth;
+    entries.push_back(entry);
+    if (!outFile)
+        throw runtime_error("Erro a escrever o conjunto de modelos em " + filename);
+}
+
+void BundleWriter::close() {
+    if (entries.size() != count)
+        throw runtime_error("O conjunto " + filename + " não tem todos os modelos");
+    BundleHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BUNDLE_MAGIC, sizeof(header.magic));
+    header.version = BUNDLE_FORMAT_VERSION;
+    header.endianTag = MODEL_ENDIAN_TAG;
+    header.count = count;
+    outFile.seekp(0);
+    outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BundleEntry));
+    outFile.close();
+    if (!outFile)
+        throw runtime_error("Erro a escrever o conjunto de modelos em " + filename);
+}
+
+MappedFile::MappedFile() : address(nullptr), length(0) {}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string &filename) {
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // O mapeamento mantém-se válido depois de fechar o descritor
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    address = mapped;
+    length = info.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (address) {
+        munmap(address, length);
+        address = nullptr;
+        length = 0;
+    }
+}
+
+const unsigned char *MappedFile::data() const {
+    return static_cast<const unsigned char*>(address);
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+bool readBundleDirectory(const MappedFile &file, vector<BundleEntry> &entries) {
+    BundleHeader header;
+    if (file.size() < sizeof(header))
+        return false;
+    memcpy(&header, file.data(), sizeof(header));
+    if (memcmp(header.magic, BUNDLE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != BUNDLE_FORMAT_VERSION || header.endianTag != MODEL_ENDIAN_TAG ||
+        sizeof(header) + static_cast<uint64_t>(header.count) * sizeof(BundleEntry) > file.size())
+        return false;
+    entries.resize(header.count);
+    memcpy(entries.data(), file.data() + sizeof(header), header.count * sizeof(BundleEntry));
+    // Os valores vêm do ficheiro: comparados sem somas, para que não transbordem
+    for (const BundleEntry &entry : entries) {
+        if (entry.offset % MODEL_PAYLOAD_ALIGNMENT != 0 || entry.offset > file.size() ||
+            entry.size > file.size() - entry.offset)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,124 @@
+#ifndef MODELFILE_HPP
+#define MODELFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+// Formato versionado dos modelos. O cabeçalho ocupa 64 bytes e a tabela começa
+// em payloadOffset (alinhado), pelo que o ficheiro pode ser mapeado em memória
+// e usado diretamente, sem cópias, por vários processos em simultâneo.
+//
+// Os ficheiros antigos (um int com k seguido das contagens) continuam legíveis:
+// não começam pela assinatura "TAIM".
+
+static const char MODEL_MAGIC[4] = {'T', 'A', 'I', 'M'};
+static const uint32_t MODEL_FORMAT_VERSION = 1;
+static const uint32_t MODEL_ENDIAN_TAG = 0x01020304;
+static const uint64_t MODEL_PAYLOAD_ALIGNMENT = 64;
+
+enum ModelLayout : uint8_t {
+    LAYOUT_DENSE_COUNTS = 0,   // 4^k contextos x 4 contagens inteiras
+    LAYOUT_COMPILED = 1,       // 4^k contextos x 4 custos float (-log2 P)
+    LAYOUT_SPARSE_COUNTS = 2   // tabela de dispersão de SparseEntry (numEntries = capacidade)
+};
+
+struct ModelHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t endianTag;         // MODEL_ENDIAN_TAG na ordem de bytes de quem gravou
+    uint8_t countWidth;         // bytes por entrada da tabela
+    uint8_t layout;             // ModelLayout
+    uint16_t reserved0;
+    int32_t k;
+    uint32_t reserved1;
+    uint64_t numEntries;        // número de entradas da tabela
+    double alpha;               // alpha usado (apenas modelos compilados)
+    uint64_t payloadOffset;     // posição da tabela no ficheiro
+    uint8_t reserved2[16];
+};
+
+static_assert(sizeof(ModelHeader) == 64, "O cabeçalho do modelo deve ocupar 64 bytes");
+
+ModelHeader makeModelHeader(ModelLayout layout, uint8_t countWidth, int k, uint64_t numEntries, double alpha = 0.0);
+
+// Verifica se a tabela descrita pelo cabeçalho (já com assinatura, versão e ordem
+// de bytes conferidas) é coerente e cabe nos size bytes do modelo: organização
+// conhecida, largura e número de entradas de acordo com k e payloadOffset alinhado
+bool validModelTable(const ModelHeader &header, uint64_t size);
+
+// Grava cabeçalho e tabela; lança runtime_error em caso de erro
+void writeModelFile(const string &filename, const ModelHeader &header, const void *payload);
+
+// Conjunto de modelos de várias ordens k num único ficheiro. O cabeçalho é seguido
+// de um diretório com uma entrada por modelo; cada modelo é uma cópia completa de
+// um ficheiro de modelo (cabeçalho + tabela), alinhada, cujo payloadOffset é
+// relativo ao início desse modelo.
+
+static const char BUNDLE_MAGIC[4] = {'T', 'A', 'I', 'B'};
+static const uint32_t BUNDLE_FORMAT_VERSION = 1;
+
+struct BundleHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t endianTag;         // MODEL_ENDIAN_TAG na ordem de bytes de quem gravou
+    uint32_t count;             // número de modelos no diretório
+    uint8_t reserved[48];
+};
+
+struct BundleEntry {
+    int32_t k;
+    uint32_t reserved;
+    uint64_t offset;            // posição do cabeçalho do modelo no ficheiro
+    uint64_t size;              // bytes do modelo (cabeçalho, alinhamento e tabela)
+    uint64_t reserved1;
+};
+
+static_assert(sizeof(BundleHeader) == 64, "O cabeçalho do conjunto deve ocupar 64 bytes");
+static_assert(sizeof(BundleEntry) == 32, "A entrada do diretório deve ocupar 32 bytes");
+
+// Grava um conjunto de modelos à medida que são adicionados, para que só seja
+// preciso manter em memória o modelo atual; o diretório é escrito em close().
+// Lança runtime_error em caso de erro
+class BundleWriter {
+public:
+    BundleWriter(const string &filename, uint32_t count);
+
+    void add(const ModelHeader &header, const void *payload);
+    void close();
+
+private:
+    string filename;
+    ofstream outFile;
+    vector<BundleEntry> entries;
+    uint32_t count;
+};
+
+// Mapeamento só de leitura de um ficheiro completo (RAII)
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    bool open(const string &filename);
+    void close();
+
+    const unsigned char *data() const;
+    size_t size() const;
+
+private:
+    void *address;
+    size_t length;
+};
+
+// Lê o diretório de um conjunto de modelos já mapeado; devolve false se não for válido
+bool readBundleDirectory(const MappedFile &file, vector<BundleEntry> &entries);
+
+#endif
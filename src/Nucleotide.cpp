@@ -0,0 +1,177 @@
+#include "Nucleotide.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define NUCLEOTIDE_X86 1
+#endif
+
+using namespace std;
+
+// Versões escalares, usadas sempre no resto de cada bloco
+static size_t encodeScalar(const char *in, size_t n, uint8_t *codes) {
+    size_t invalid = 0;
+    for (size_t i = 0; i < n; i++) {
+        int sym = nucleotideIndex(in[i]);
+        invalid += sym < 0;
+        codes[i] = sym < 0 ? NUCLEOTIDE_INVALID : sym;
+    }
+    return invalid;
+}
+
+static void packScalar(const char *in, size_t n, uint8_t *packed, vector<size_t> &invalid, size_t offset) {
+    for (size_t i = 0; i < n; i += 4) {
+        uint8_t byte = 0;
+        for (size_t j = 0; j < 4 && i + j < n; j++) {
+            int sym = nucleotideIndex(in[i + j]);
+            if (sym < 0)
+                invalid.push_back(offset + i + j);
+            else
+                byte |= sym << (2 * j);
+        }
+        packed[i / 4] = byte;
+    }
+}
+
+#ifdef NUCLEOTIDE_X86
+
+// Cada caractere passa a minúsculas (c | 0x20) e é comparado com a, c, g e t;
+// o código é 1, 2 ou 3 conforme a comparação que acerta (0 para a e para os
+// inválidos), e os bits de valid marcam os caracteres de ACGT. A conversão para minúsculas não cria falsos
+// positivos: só A/a, C/c, G/g e T/t dão as letras comparadas.
+
+__attribute__((target("avx2"))) static inline __m256i classify32(const char *in, __m256i &valid) {
+    __m256i c = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in)), _mm256_set1_epi8(0x20));
+    __m256i a = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('a'));
+    __m256i cc = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('c'));
+    __m256i g = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('g'));
+    __m256i t = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('t'));
+    valid = _mm256_or_si256(_mm256_or_si256(a, cc), _mm256_or_si256(g, t));
+    return _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(cc, t), _mm256_set1_epi8(1)),
+                           _mm256_and_si256(_mm256_or_si256(g, t), _mm256_set1_epi8(2)));
+}
+
+__attribute__((target("avx2,popcnt"))) static size_t encodeAvx2(const char *in, size_t n, uint8_t *codes) {
+    size_t invalid = 0;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i valid;
+        __m256i code = classify32(in + i, valid);
+        code = _mm256_or_si256(code, _mm256_andnot_si256(valid, _mm256_set1_epi8(NUCLEOTIDE_INVALID)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(codes + i), code);
+        invalid += 32 - _mm_popcnt_u32(static_cast<uint32_t>(_mm256_movemask_epi8(valid)));
+    }
+    return invalid + encodeScalar(in + i, n - i, codes + i);
+}
+
+__attribute__((target("avx2"))) static void packAvx2(const char *in, size_t n, uint8_t *packed,
+                                                     vector<size_t> &invalid) {
+    // Junta 4 códigos de 2 bits em cada grupo de 32 bits: c0 + 4c1 em 16 bits
+    // e depois (c0 + 4c1) + 16(c2 + 4c3); o byte baixo de cada grupo é o resultado
+    const __m256i pairs = _mm256_set1_epi16(0x0401);
+    const __m256i quads = _mm256_set1_epi32(0x00100001);
+    const __m256i gather = _mm256_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                            0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i valid;
+        __m256i code = classify32(in + i, valid);
+        __m256i bytes = _mm256_shuffle_epi8(_mm256_madd_epi16(_mm256_maddubs_epi16(code, pairs), quads), gather);
+        uint32_t low = _mm256_extract_epi32(bytes, 0), high = _mm256_extract_epi32(bytes, 4);
+        memcpy(packed + i / 4, &low, 4);
+        memcpy(packed + i / 4 + 4, &high, 4);
+        for (uint32_t bad = ~static_cast<uint32_t>(_mm256_movemask_epi8(valid)); bad; bad &= bad - 1)
+            invalid.push_back(i + __builtin_ctz(bad));
+    }
+    packScalar(in + i, n - i, packed + i / 4, invalid, i);
+}
+
+__attribute__((target("sse4.1"))) static inline __m128i classify16(const char *in, __m128i &valid) {
+    __m128i c = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in)), _mm_set1_epi8(0x20));
+    __m128i a = _mm_cmpeq_epi8(c, _mm_set1_epi8('a'));
+    __m128i cc = _mm_cmpeq_epi8(c, _mm_set1_epi8('c'));
+    __m128i g = _mm_cmpeq_epi8(c, _mm_set1_epi8('g'));
+    __m128i t = _mm_cmpeq_epi8(c, _mm_set1_epi8('t'));
+    valid = _mm_or_si128(_mm_or_si128(a, cc), _mm_or_si128(g, t));
+    return _mm_or_si128(_mm_and_si128(_mm_or_si128(cc, t), _mm_set1_epi8(1)),
+                        _mm_and_si128(_mm_or_si128(g, t), _mm_set1_epi8(2)));
+}
+
+__attribute__((target("sse4.1,popcnt"))) static size_t encodeSse41(const char *in, size_t n, uint8_t *codes) {
+    size_t invalid = 0;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i valid;
+        __m128i code = classify16(in + i, valid);
+        code = _mm_or_si128(code, _mm_andnot_si128(valid, _mm_set1_epi8(NUCLEOTIDE_INVALID)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(codes + i), code);
+        invalid += 16 - _mm_popcnt_u32(static_cast<uint32_t>(_mm_movemask_epi8(valid)));
+    }
+    return invalid + encodeScalar(in + i, n - i, codes + i);
+}
+
+__attribute__((target("sse4.1"))) static void packSse41(const char *in, size_t n, uint8_t *packed,
+                                                         vector<size_t> &invalid) {
+    const __m128i pairs = _mm_set1_epi16(0x0401);
+    const __m128i quads = _mm_set1_epi32(0x00100001);
+    const __m128i gather = _mm_setr_epi8(0, 4, 8, 12, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i valid;
+        __m128i code = classify16(in + i, valid);
+        uint32_t bytes = _mm_cvtsi128_si32(
+            _mm_shuffle_epi8(_mm_madd_epi16(_mm_maddubs_epi16(code, pairs), quads), gather));
+        memcpy(packed + i / 4, &bytes, 4);
+        for (uint32_t bad = ~static_cast<uint32_t>(_mm_movemask_epi8(valid)) & 0xFFFF; bad; bad &= bad - 1)
+            invalid.push_back(i + __builtin_ctz(bad));
+    }
+    packScalar(in + i, n - i, packed + i / 4, invalid, i);
+}
+
+#endif
+
+static void packScalarAll(const char *in, size_t n, uint8_t *packed, vector<size_t> &invalid) {
+    packScalar(in, n, packed, invalid, 0);
+}
+
+struct NucleotideKernel {
+    const char *name;
+    size_t (*encode)(const char *, size_t, uint8_t *);
+    void (*pack)(const char *, size_t, uint8_t *, vector<size_t> &);
+};
+
+// Escolhe o núcleo na primeira utilização; NUCLEOTIDE_KERNEL=scalar|sse4.1
+// limita a escolha (para comparar as versões)
+static const NucleotideKernel &kernel() {
+    static const NucleotideKernel chosen = [] {
+        NucleotideKernel k{"scalar", encodeScalar, packScalarAll};
+#ifdef NUCLEOTIDE_X86
+        const char *limit = getenv("NUCLEOTIDE_KERNEL");
+        string wanted = limit ? limit : "";
+        __builtin_cpu_init();
+        if (wanted == "scalar")
+            return k;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt") &&
+            wanted != "sse4.1")
+            return NucleotideKernel{"avx2", encodeAvx2, packAvx2};
+        if (__builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt"))
+            return NucleotideKernel{"sse4.1", encodeSse41, packSse41};
+#endif
+        return k;
+    }();
+    return chosen;
+}
+
+size_t encodeNucleotides(const char *in, size_t n, uint8_t *codes) {
+    return kernel().encode(in, n, codes);
+}
+
+void packNucleotides(const char *in, size_t n, uint8_t *packed, vector<size_t> &invalid) {
+    kernel().pack(in, n, packed, invalid);
+}
+
+const char *nucleotideKernel() {
+    return kernel().name;
+}
@@ -0,0 +1,71 @@
+#ifndef NUCLEOTIDE_HPP
+#define NUCLEOTIDE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Tabela de 256 entradas que converte um byte no índice do nucleótido
+// (A=0, C=1, G=2, T=3, maiúsculas ou minúsculas) ou -1 para símbolos inválidos
+inline const array<int8_t, 256> NUCLEOTIDE_INDEX = [] {
+    array<int8_t, 256> table{};
+    table.fill(-1);
+    table['A'] = table['a'] = 0;
+    table['C'] = table['c'] = 1;
+    table['G'] = table['g'] = 2;
+    table['T'] = table['t'] = 3;
+    return table;
+}();
+
+inline int nucleotideIndex(char c) {
+    return NUCLEOTIDE_INDEX[static_cast<unsigned char>(c)];
+}
+
+// Código dos símbolos inválidos em encodeNucleotides
+static const uint8_t NUCLEOTIDE_INVALID = 4;
+
+// Núcleos vetoriais para converter blocos de caracteres, escolhidos em tempo de
+// execução conforme o processador (AVX2, SSE4.1 ou a versão escalar); todos dão
+// o mesmo resultado que nucleotideIndex aplicado a cada caractere.
+
+// Converte n caracteres nos códigos 0-3 ou NUCLEOTIDE_INVALID; devolve o número de inválidos
+size_t encodeNucleotides(const char *in, size_t n, uint8_t *codes);
+
+// Empacota n caracteres a 2 bits (4 por byte, o primeiro nos bits menos
+// significativos; os inválidos ficam a 0, packed tem (n + 3) / 4 bytes) e
+// acrescenta a invalid a posição de cada símbolo inválido
+void packNucleotides(const char *in, size_t n, uint8_t *packed, vector<size_t> &invalid);
+
+// Converte os n caracteres em blocos com encodeNucleotides e chama
+// visit(início, códigos, tamanho) para cada bloco; pára quando visit devolve false.
+// Devolve false se a passagem foi interrompida
+template <typename VisitBlock>
+inline bool forEachNucleotideBlock(const char *in, size_t n, VisitBlock visit) {
+    const size_t BLOCK = 4096;
+    uint8_t codes[BLOCK];
+    for (size_t begin = 0; begin < n; begin += BLOCK) {
+        size_t length = n - begin < BLOCK ? n - begin : BLOCK;
+        encodeNucleotides(in + begin, length, codes);
+        if (!visit(begin, static_cast<const uint8_t *>(codes), length))
+            return false;
+    }
+    return true;
+}
+
+// Chama visit(i, código) para cada um dos n caracteres
+template <typename Visit>
+inline void forEachNucleotide(const char *in, size_t n, Visit visit) {
+    forEachNucleotideBlock(in, n, [&visit](size_t begin, const uint8_t *codes, size_t length) {
+        for (size_t j = 0; j < length; j++)
+            visit(begin + j, codes[j]);
+        return true;
+    });
+}
+
+// Núcleo escolhido ("avx2", "sse4.1" ou "scalar")
+const char *nucleotideKernel();
+
+#endif
@@ -0,0 +1,58 @@
+#include "RecordReader.hpp"
+#include "TextUtils.hpp"
+
+using namespace std;
+
+RecordReader::RecordReader(LineChannel &channel) : channel(channel), hasHeader(false) {}
+
+bool RecordReader::next(string &id, string &sequence) {
+    string line;
+    while (true) {
+        // Procura o cabeçalho do registo (o texto antes do primeiro é ignorado)
+        if (!hasHeader) {
+            while (channel.readLine(line)) {
+                trim(line);
+                if (!line.empty() && (line[0] == '>' || line[0] == '@')) {
+                    header.swap(line);
+                    hasHeader = true;
+                    break;
+                }
+            }
+            if (!hasHeader)
+                return false;
+        }
+        hasHeader = false;
+        const bool fastqCandidate = header[0] == '@';
+        id.assign(header, 1, string::npos);
+        sequence.clear();
+
+        while (channel.readLine(line)) {
+            trim(line);
+            if (line.empty())
+                continue;
+            if (line[0] == '>' || line[0] == '@') {
+                header.swap(line);
+                hasHeader = true;
+                break;
+            }
+            if (line[0] == '+' && fastqCandidate) {
+                // Qualidade com o comprimento da sequência, em uma ou mais linhas
+                size_t quality = 0;
+                while (quality < sequence.size() && channel.readLine(line)) {
+                    trim(line);
+                    quality += line.size();
+                }
+                break;
+            }
+            sequence += line;
+        }
+        // Registos vazios (e.g. leituras FASTQ cortadas a zero por trimming) são
+        // saltados; o fim dos dados é detetado na procura do cabeçalho seguinte
+        if (!sequence.empty())
+            return true;
+    }
+}
+
+bool RecordReader::pending() {
+    return channel.pending();
+}
@@ -0,0 +1,34 @@
+#ifndef RECORDREADER_HPP
+#define RECORDREADER_HPP
+
+#include <string>
+#include "ScoreProtocol.hpp"
+
+using namespace std;
+
+// Lê registos de sequências à medida que chegam (e.g. de stdin, atrás de um
+// pipe), sem os guardar: FASTA ('>' e linhas de sequência), a base de dados
+// do projeto ('@' e linhas de sequência) e FASTQ ('@', sequência, '+' e
+// qualidade). Um registo '@' seguido de uma linha '+' é FASTQ; a qualidade é
+// lida pelo comprimento da sequência, pelo que pode começar por '@'.
+//
+// Um registo FASTQ está completo no fim da qualidade; um registo FASTA ou da
+// base de dados só quando chega o cabeçalho seguinte (ou o fim dos dados).
+class RecordReader {
+public:
+    explicit RecordReader(LineChannel &channel);
+
+    // Próximo registo com sequência não vazia; false no fim dos dados
+    bool next(string &id, string &sequence);
+
+    // Indica se há dados já disponíveis, i.e. se ler o próximo registo
+    // provavelmente não vai ficar à espera da entrada
+    bool pending();
+
+private:
+    LineChannel &channel;
+    string header;             // cabeçalho já lido do registo seguinte
+    bool hasHeader;
+};
+
+#endif
@@ -0,0 +1,105 @@
+#include "ScoreProtocol.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Envios acima deste tamanho são feitos de imediato
+static const size_t OUTPUT_CHUNK = 1 << 16;
+
+LineChannel::LineChannel(int in, int out) : in(in), out(out), inputStart(0) {}
+
+bool LineChannel::readLine(string &line) {
+    while (true) {
+        size_t newline = input.find('\n', inputStart);
+        if (newline != string::npos) {
+            size_t end = newline > inputStart && input[newline - 1] == '\r' ? newline - 1 : newline;
+            line.assign(input, inputStart, end - inputStart);
+            inputStart = newline + 1;
+            return true;
+        }
+        // Descarta as linhas já lidas antes de ler mais
+        input.erase(0, inputStart);
+        inputStart = 0;
+        char buffer[1 << 16];
+        ssize_t received = ::read(in, buffer, sizeof(buffer));
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0) {
+            if (input.empty())
+                return false;
+            line.swap(input);
+            input.clear();
+            return true;
+        }
+        input.append(buffer, received);
+    }
+}
+
+bool LineChannel::pending() {
+    if (input.find('\n', inputStart) != string::npos)
+        return true;
+    pollfd ready{in, POLLIN, 0};
+    return ::poll(&ready, 1, 0) > 0;
+}
+
+void LineChannel::write(const string &text) {
+    output += text;
+    if (output.size() >= OUTPUT_CHUNK)
+        flush();
+}
+
+void LineChannel::flush() {
+    size_t sent = 0;
+    while (sent < output.size()) {
+        ssize_t written = ::write(out, output.data() + sent, output.size() - sent);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            throw runtime_error(string("Erro a enviar a resposta: ") + strerror(errno));
+        sent += written;
+    }
+    output.clear();
+}
+
+// Endereço do socket Unix em path
+static sockaddr_un unixAddress(const string &path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        throw runtime_error("Caminho do socket demasiado longo: " + path);
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+int listenUnixSocket(const string &path) {
+    sockaddr_un address = unixAddress(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw runtime_error(string("Erro ao criar o socket: ") + strerror(errno));
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(fd, 64) < 0) {
+        string error = strerror(errno);
+        close(fd);
+        throw runtime_error("Erro ao escutar em " + path + ": " + error);
+    }
+    return fd;
+}
+
+int connectUnixSocket(const string &path) {
+    sockaddr_un address = unixAddress(path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw runtime_error(string("Erro ao criar o socket: ") + strerror(errno));
+    if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+        string error = strerror(errno);
+        close(fd);
+        throw runtime_error("Erro ao ligar a " + path + ": " + error);
+    }
+    return fd;
+}
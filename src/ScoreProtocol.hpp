@@ -0,0 +1,56 @@
+#ifndef SCOREPROTOCOL_HPP
+#define SCOREPROTOCOL_HPP
+
+#include <string>
+
+using namespace std;
+
+// Protocolo de linhas entre score_server e os clientes (score_client,
+// bench_score_server), num socket Unix ou em stdin/stdout. Cada pedido é uma
+// linha de comando, eventualmente seguida de linhas de dados; cada resposta
+// começa por "OK <n>" seguida de n linhas, ou por "ERR <mensagem>".
+//
+//   SCORE <alpha> <n>          + n linhas "<id>\t<sequência>"
+//       -> n linhas "<id>\t<nrc>", pela ordem do pedido
+//   TOP <alpha> <t> <n>        + n linhas "<id>\t<sequência>"
+//       -> as t melhores: "<posição>\t<id>\t<nrc>"
+//   DB <alpha> <t> <ficheiro>  top-t da base de dados (texto ou db_pack) lida pelo servidor
+//       -> como TOP
+//   PING                       -> "OK 0"
+//   QUIT                       termina a ligação
+//   SHUTDOWN                   termina o servidor
+//
+// Os NRC são escritos com 17 algarismos significativos, pelo que são iguais
+// aos calculados localmente.
+
+// Extremo de uma ligação: lê linhas de um descritor e escreve noutro (iguais
+// num socket, 0 e 1 em stdin/stdout). Lança runtime_error se a escrita falhar
+class LineChannel {
+public:
+    LineChannel(int in, int out);
+
+    // Lê a próxima linha sem o '\n' (e sem '\r'); false no fim dos dados
+    bool readLine(string &line);
+
+    // Indica se há uma linha completa em memória ou dados prontos a ler no
+    // descritor (ou o fim dos dados), i.e. se readLine não fica à espera
+    bool pending();
+
+    // Acumula texto para enviar; flush envia tudo o que está acumulado
+    void write(const string &text);
+    void flush();
+
+private:
+    int in, out;
+    string input;
+    size_t inputStart;
+    string output;
+};
+
+// Socket Unix à escuta em path (removendo um socket antigo); lança runtime_error
+int listenUnixSocket(const string &path);
+
+// Liga ao servidor em path; lança runtime_error
+int connectUnixSocket(const string &path);
+
+#endif
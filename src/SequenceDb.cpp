@@ -0,0 +1,178 @@
+#include "SequenceDb.hpp"
+#include "Stats.hpp"
+#include "TextUtils.hpp"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+uint64_t hashId(const char *id, size_t length) {
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h ^= static_cast<unsigned char>(id[i]);
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+void readTextDatabase(istream &in, const function<void(const string &, const string &)> &record) {
+    string line, current_id, current_seq;
+    while (getline(in, line)) {
+        trim(line);
+        if (line.empty()) continue;
+        if (line[0] == '@') {
+            if (!current_id.empty() && !current_seq.empty())
+                record(current_id, current_seq);
+            current_id = line.substr(1);
+            current_seq.clear();
+        } else {
+            current_seq += line;
+        }
+    }
+    if (!current_id.empty() && !current_seq.empty())
+        record(current_id, current_seq);
+}
+
+// Os 4 símbolos de cada byte empacotado, para descodificar um byte de cada vez
+struct PackedDecoder {
+    char symbols[256][4];
+
+    PackedDecoder() {
+        for (int b = 0; b < 256; b++)
+            for (int j = 0; j < 4; j++)
+                symbols[b][j] = "ACGT"[(b >> (2 * j)) & 3];
+    }
+};
+
+static const PackedDecoder PACKED_DECODER;
+
+SequenceDb::SequenceDb() : records(nullptr), index(nullptr), indexCapacity(0), count(0) {}
+
+bool SequenceDb::open(const string &filename) {
+    ids.clear();
+    sequences.clear();
+    mapping.reset();
+    records = nullptr;
+    index = nullptr;
+    count = 0;
+
+    ifstream in(filename, ios::binary);
+    if (!in) {
+        cerr << "Erro ao abrir o ficheiro da base de dados: " << filename << endl;
+        return false;
+    }
+    char magic[4] = {};
+    in.read(magic, sizeof(magic));
+    if (in && memcmp(magic, DB_MAGIC, sizeof(magic)) == 0) {
+        in.close();
+        return openPacked(filename);
+    }
+    in.clear();
+    in.seekg(0);
+    readTextDatabase(in, [this](const string &id, const string &seq) {
+        ids.push_back(id);
+        sequences.push_back(seq);
+    });
+    count = ids.size();
+    in.clear();
+    in.seekg(0, ios::end);
+    statsAdd(STAT_BYTES_READ, static_cast<uint64_t>(in.tellg()));
+    return true;
+}
+
+bool SequenceDb::openPacked(const string &filename) {
+    auto file = make_shared<MappedFile>();
+    DbHeader header;
+    if (!file->open(filename) || file->size() < sizeof(header)) {
+        cerr << "Erro ao mapear a base de dados: " << filename << endl;
+        return false;
+    }
+    memcpy(&header, file->data(), sizeof(header));
+    if (header.version != DB_FORMAT_VERSION || header.endianTag != MODEL_ENDIAN_TAG ||
+        header.recordsOffset % 8 != 0 || header.indexOffset % 8 != 0 ||
+        (header.indexCapacity & (header.indexCapacity - 1)) != 0 || header.indexCapacity <= header.count ||
+        header.recordsOffset + header.count * sizeof(DbRecord) > file->size() ||
+        header.indexOffset + header.indexCapacity * sizeof(uint64_t) > file->size()) {
+        cerr << "Cabeçalho inválido na base de dados: " << filename << endl;
+        return false;
+    }
+    records = reinterpret_cast<const DbRecord *>(file->data() + header.recordsOffset);
+    index = reinterpret_cast<const uint64_t *>(file->data() + header.indexOffset);
+    indexCapacity = header.indexCapacity;
+    count = header.count;
+    for (size_t i = 0; i < count; i++) {
+        const DbRecord &r = records[i];
+        if (r.idOffset + r.idLength > file->size() || r.packedOffset + (r.length + 3) / 4 > file->size() ||
+            r.runsOffset % 8 != 0 || r.runsOffset + r.runCount * sizeof(DbRun) > file->size()) {
+            cerr << "Registo inválido na base de dados: " << filename << endl;
+            count = 0;
+            return false;
+        }
+    }
+    mapping = file;
+    statsAdd(STAT_BYTES_MAPPED, file->size());
+    return true;
+}
+
+size_t SequenceDb::size() const {
+    return count;
+}
+
+string SequenceDb::id(size_t i) const {
+    if (!mapping)
+        return ids[i];
+    const DbRecord &r = records[i];
+    return string(reinterpret_cast<const char *>(mapping->data() + r.idOffset), r.idLength);
+}
+
+size_t SequenceDb::length(size_t i) const {
+    return mapping ? records[i].length : sequences[i].size();
+}
+
+string SequenceDb::sequence(size_t i) const {
+    if (!mapping)
+        return sequences[i];
+    const DbRecord &r = records[i];
+    string seq(r.length, 'A');
+    const unsigned char *packed = mapping->data() + r.packedOffset;
+    char *out = &seq[0];
+
+    // Bytes completos de 4 símbolos e, no fim, o byte parcial
+    size_t fullBytes = r.length / 4;
+    for (size_t b = 0; b < fullBytes; b++)
+        memcpy(out + 4 * b, PACKED_DECODER.symbols[packed[b]], 4);
+    for (size_t p = fullBytes * 4; p < r.length; p++)
+        out[p] = "ACGT"[(packed[p / 4] >> (2 * (p % 4))) & 3];
+
+    // Repõe os símbolos fora de ACGT
+    const DbRun *runs = reinterpret_cast<const DbRun *>(mapping->data() + r.runsOffset);
+    for (uint32_t j = 0; j < r.runCount; j++) {
+        if (runs[j].position + runs[j].length <= r.length)
+            memset(out + runs[j].position, runs[j].symbol, runs[j].length);
+    }
+    return seq;
+}
+
+long SequenceDb::find(const string &target) const {
+    if (!mapping) {
+        for (size_t i = 0; i < ids.size(); i++)
+            if (ids[i] == target)
+                return i;
+        return -1;
+    }
+    uint64_t mask = indexCapacity - 1;
+    for (uint64_t slot = hashId(target.data(), target.size()) & mask;; slot = (slot + 1) & mask) {
+        uint64_t entry = index[slot];
+        if (entry == 0 || entry > count)
+            return -1;
+        const DbRecord &r = records[entry - 1];
+        if (r.idLength == target.size() &&
+            memcmp(mapping->data() + r.idOffset, target.data(), target.size()) == 0)
+            return entry - 1;
+    }
+}
+
+bool SequenceDb::isPacked() const {
+    return mapping != nullptr;
+}
@@ -0,0 +1,105 @@
+#ifndef SEQUENCEDB_HPP
+#define SEQUENCEDB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <string>
+#include <vector>
+#include "ModelFile.hpp"
+
+using namespace std;
+
+// Base de dados de sequências partilhada por main, similarities_*, e complexity_profile.
+// Aceita o ficheiro de texto (@id seguido das linhas da sequência) ou o formato
+// binário gerado por db_pack, em que cada sequência está empacotada a 2 bits por
+// símbolo e os identificadores têm um índice de dispersão.
+//
+// Formato binário (mapeado em memória e lido sem cópias):
+//   DbHeader | dados de cada registo (sequência empacotada, símbolos inválidos,
+//   identificador) | tabela de DbRecord | índice (capacidade potência de 2,
+//   índice do registo + 1 em cada posição ocupada, sondagem linear)
+//
+// Os símbolos ACGT (maiúsculos ou minúsculos) são guardados como 0-3, o primeiro
+// símbolo de cada byte nos bits menos significativos; os restantes caracteres
+// (N, etc.) ficam numa lista de sequências de caracteres iguais, pelo que a
+// sequência lida é a original com ACGT em maiúsculas.
+
+static const char DB_MAGIC[4] = {'T', 'A', 'I', 'D'};
+static const uint32_t DB_FORMAT_VERSION = 1;
+
+struct DbHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t endianTag;         // MODEL_ENDIAN_TAG na ordem de bytes de quem gravou
+    uint32_t reserved0;
+    uint64_t count;             // número de registos
+    uint64_t recordsOffset;     // posição da tabela de DbRecord
+    uint64_t indexOffset;       // posição do índice dos identificadores
+    uint64_t indexCapacity;
+    uint8_t reserved1[16];
+};
+
+struct DbRecord {
+    uint64_t idOffset;
+    uint64_t length;            // número de símbolos da sequência
+    uint64_t packedOffset;      // (length + 3) / 4 bytes
+    uint64_t runsOffset;        // runCount DbRun
+    uint32_t idLength;
+    uint32_t runCount;
+};
+
+// Sequência de length caracteres iguais e fora de ACGT a partir de position
+struct DbRun {
+    uint64_t position;
+    uint32_t length;
+    uint8_t symbol;
+    uint8_t reserved[3];
+};
+
+static_assert(sizeof(DbHeader) == 64, "O cabeçalho da base de dados deve ocupar 64 bytes");
+static_assert(sizeof(DbRecord) == 40, "DbRecord deve ocupar 40 bytes");
+static_assert(sizeof(DbRun) == 16, "DbRun deve ocupar 16 bytes");
+
+// Dispersão dos identificadores no índice (FNV-1a de 64 bits)
+uint64_t hashId(const char *id, size_t length);
+
+// Lê a base de dados em texto, chamando record(id, sequência) por cada registo
+// não vazio. As linhas perdem os espaços finais e as vazias são ignoradas.
+void readTextDatabase(istream &in, const function<void(const string &, const string &)> &record);
+
+class SequenceDb {
+public:
+    SequenceDb();
+
+    // Abre a base de dados em texto (lida para memória) ou binária (mapeada)
+    bool open(const string &filename);
+
+    size_t size() const;
+    string id(size_t i) const;
+    size_t length(size_t i) const;
+    string sequence(size_t i) const;
+
+    // Índice do primeiro registo com o identificador dado, ou -1 se não existir
+    long find(const string &id) const;
+
+    bool isPacked() const;
+
+private:
+    // Base de dados em texto
+    vector<string> ids;
+    vector<string> sequences;
+
+    // Base de dados binária
+    shared_ptr<MappedFile> mapping;
+    const DbRecord *records;
+    const uint64_t *index;
+    uint64_t indexCapacity;
+    size_t count;
+
+    bool openPacked(const string &filename);
+};
+
+#endif
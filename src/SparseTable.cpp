@@ -0,0 +1,70 @@
+#include "SparseTable.hpp"
+#include <algorithm>
+
+using namespace std;
+
+static size_t capacityFor(size_t contexts) {
+    size_t capacity = 16;
+    while (capacity < contexts * 2)
+        capacity *= 2;
+    return capacity;
+}
+
+SparseTable::SparseTable(size_t expectedContexts)
+    : entries(capacityFor(expectedContexts), SparseEntry{}), used(0) {}
+
+bool SparseTable::add(uint64_t context, int sym, uint32_t count) {
+    uint64_t key = context + 1;
+    uint64_t mask = entries.size() - 1;
+    for (uint64_t slot = sparseSlot(key, mask);; slot = (slot + 1) & mask) {
+        SparseEntry &entry = entries[slot];
+        if (entry.key == key) {
+            // O total é pelo menos a contagem do símbolo: se não saturar, ela também não
+            uint64_t symbolCount = static_cast<uint64_t>(entry.counts[sym]) + count;
+            uint64_t total = static_cast<uint64_t>(entry.total) + count;
+            entry.counts[sym] = static_cast<uint32_t>(min<uint64_t>(symbolCount, UINT32_MAX));
+            entry.total = static_cast<uint32_t>(min<uint64_t>(total, UINT32_MAX));
+            return total > UINT32_MAX;
+        }
+        if (entry.key == 0) {
+            entry.key = key;
+            entry.counts[sym] = count;
+            entry.total = count;
+            if (++used * 2 > entries.size())
+                rehash(entries.size() * 2);
+            return false;
+        }
+    }
+}
+
+void SparseTable::shrinkToFit() {
+    size_t capacity = capacityFor(used);
+    if (capacity < entries.size())
+        rehash(capacity);
+}
+
+void SparseTable::rehash(size_t newCapacity) {
+    vector<SparseEntry> old(newCapacity, SparseEntry{});
+    old.swap(entries);
+    uint64_t mask = entries.size() - 1;
+    for (const SparseEntry &entry : old) {
+        if (entry.key == 0)
+            continue;
+        uint64_t slot = sparseSlot(entry.key, mask);
+        while (entries[slot].key != 0)
+            slot = (slot + 1) & mask;
+        entries[slot] = entry;
+    }
+}
+
+size_t SparseTable::size() const {
+    return used;
+}
+
+size_t SparseTable::capacity() const {
+    return entries.size();
+}
+
+const SparseEntry *SparseTable::data() const {
+    return entries.data();
+}
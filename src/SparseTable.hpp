@@ -0,0 +1,79 @@
+#ifndef SPARSETABLE_HPP
+#define SPARSETABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Entrada da tabela esparsa: contexto (guardado como contexto + 1, 0 = vazia),
+// contagens dos 4 símbolos seguintes e o total do contexto. Ocupa 32 bytes para
+// que cada consulta toque numa única linha de cache.
+struct SparseEntry {
+    uint64_t key;
+    uint32_t counts[4];
+    uint32_t total;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(SparseEntry) == 32, "SparseEntry deve ocupar 32 bytes");
+
+// Posição inicial de procura de um contexto numa tabela com capacidade mask + 1
+inline uint64_t sparseSlot(uint64_t key, uint64_t mask) {
+    uint64_t h = key * 0x9E3779B97F4A7C15ULL;
+    return (h ^ (h >> 29)) & mask;
+}
+
+// Procura linear a partir de sparseSlot; devolve nullptr se o contexto nunca ocorreu.
+// Funciona tanto sobre a tabela em memória como sobre um ficheiro mapeado; a
+// procura pára ao fim de uma volta, para que uma tabela mapeada corrompida sem
+// entradas vazias não a deixe em ciclo infinito.
+inline const SparseEntry *sparseFind(const SparseEntry *entries, uint64_t mask, uint64_t context) {
+    uint64_t key = context + 1;
+    uint64_t slot = sparseSlot(key, mask);
+    for (uint64_t probes = 0; probes <= mask; probes++, slot = (slot + 1) & mask) {
+        const SparseEntry &entry = entries[slot];
+        if (entry.key == key)
+            return &entry;
+        if (entry.key == 0)
+            return nullptr;
+    }
+    return nullptr;
+}
+
+// Tabela de dispersão com endereçamento aberto (sondagem linear) para modelos
+// com k elevado, em que a tabela densa de 4^k contextos ficaria quase vazia.
+// A capacidade é sempre uma potência de 2 e a ocupação não passa de 50%.
+class SparseTable {
+public:
+    explicit SparseTable(size_t expectedContexts = 0);
+
+    void increment(uint64_t context, int sym) {
+        add(context, sym, 1);
+    }
+
+    // Soma count ocorrências do símbolo sym no contexto; a contagem e o total
+    // saturam em UINT32_MAX em vez de darem a volta. Devolve true se saturaram
+    bool add(uint64_t context, int sym, uint32_t count);
+
+    // Reduz a capacidade ao mínimo para o número de contextos atual (antes de gravar)
+    void shrinkToFit();
+
+    const SparseEntry *find(uint64_t context) const {
+        return sparseFind(entries.data(), entries.size() - 1, context);
+    }
+
+    // Número de contextos distintos
+    size_t size() const;
+    size_t capacity() const;
+    const SparseEntry *data() const;
+
+private:
+    vector<SparseEntry> entries;
+    size_t used;
+
+    void rehash(size_t newCapacity);
+};
+
+#endif
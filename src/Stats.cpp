@@ -0,0 +1,118 @@
+#include "Stats.hpp"
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace std;
+
+#ifndef NO_STATS
+
+atomic<uint64_t> STAT_COUNTERS[STAT_COUNTER_COUNT];
+
+static const char *COUNTER_NAMES[STAT_COUNTER_COUNT] = {
+    "bytes lidos",
+    "bytes mapeados",
+    "símbolos contados (treino)",
+    "sequências pontuadas",
+    "símbolos pontuados",
+    "posições sem contexto válido",
+    "sequências abandonadas (top-N)",
+};
+
+static const chrono::steady_clock::time_point PROCESS_START = chrono::steady_clock::now();
+static atomic<bool> reportEnabled(false);
+
+// Tempo acumulado e número de execuções de cada fase
+struct PhaseTime {
+    string name;
+    double seconds;
+    uint64_t calls;
+};
+
+static mutex phasesMutex;
+static vector<PhaseTime> phases;
+
+void statsEnable() {
+    reportEnabled = true;
+}
+
+bool statsEnabled() {
+    return reportEnabled;
+}
+
+ScopedTimer::ScopedTimer(const char *phase) : phase(phase), start(chrono::steady_clock::now()), running(true) {}
+
+ScopedTimer::~ScopedTimer() {
+    stop();
+}
+
+void ScopedTimer::stop() {
+    if (!running)
+        return;
+    running = false;
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    lock_guard<mutex> lock(phasesMutex);
+    for (PhaseTime &entry : phases) {
+        if (entry.name == phase) {
+            entry.seconds += elapsed;
+            entry.calls++;
+            return;
+        }
+    }
+    phases.push_back({phase, elapsed, 1});
+}
+
+// Nome alinhado à esquerda em 32 colunas; setw conta bytes e os nomes têm
+// acentos (UTF-8), pelo que o preenchimento conta só o primeiro byte de cada caractere
+static ostream &label(ostream &out, const string &name) {
+    size_t width = 0;
+    for (unsigned char c : name)
+        width += (c & 0xC0) != 0x80;
+    out << name << string(width < 32 ? 32 - width : 1, ' ');
+    return out;
+}
+
+void statsReport(ostream &out) {
+    double total = chrono::duration<double>(chrono::steady_clock::now() - PROCESS_START).count();
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    lock_guard<mutex> lock(phasesMutex);
+    out << "--- Estatísticas ---" << endl;
+    ios::fmtflags flags = out.flags();
+    streamsize precision = out.precision();
+    out << fixed << setprecision(4);
+    for (const PhaseTime &entry : phases) {
+        label(out, entry.name) << setw(12) << entry.seconds << " s";
+        if (entry.calls > 1)
+            out << " (" << entry.calls << " vezes)";
+        out << endl;
+    }
+    label(out, "total") << setw(12) << total << " s" << endl;
+    for (int c = 0; c < STAT_COUNTER_COUNT; c++) {
+        uint64_t value = STAT_COUNTERS[c].load();
+        if (value > 0)
+            label(out, COUNTER_NAMES[c]) << setw(12) << value << endl;
+    }
+    uint64_t scored = STAT_COUNTERS[STAT_SYMBOLS_SCORED].load();
+    if (scored > 0) {
+        label(out, "símbolos pontuados/s") << setw(12) << setprecision(0)
+            << scored / total << endl;
+        label(out, "fração sem contexto válido") << setw(12) << setprecision(6)
+            << static_cast<double>(STAT_COUNTERS[STAT_CONTEXT_FALLBACKS].load()) / scored << endl;
+    }
+    label(out, "memória máxima (RSS)") << setw(12) << setprecision(1)
+        << usage.ru_maxrss / 1024.0 << " MiB" << endl;
+    out.flags(flags);
+    out.precision(precision);
+}
+
+#endif
+
+StatsReporter::~StatsReporter() {
+    if (statsEnabled())
+        statsReport(cerr);
+}
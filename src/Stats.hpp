@@ -0,0 +1,82 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+using namespace std;
+
+// Instrumentação dos programas: tempo por fase (ScopedTimer) e contadores
+// globais, reportados com --stats. Compilando com -DNO_STATS (make STATS=0)
+// todas as funções ficam vazias e são eliminadas pelo compilador.
+
+enum StatCounter {
+    STAT_BYTES_READ,            // bytes lidos dos ficheiros de entrada (modelos, bases de dados, referências)
+    STAT_BYTES_MAPPED,          // tamanho dos ficheiros mapeados em memória (modelos, bases empacotadas)
+    STAT_SYMBOLS_COUNTED,       // símbolos percorridos no treino de modelos
+    STAT_SEQUENCES_SCORED,
+    STAT_SYMBOLS_SCORED,
+    STAT_CONTEXT_FALLBACKS,     // posições pontuadas com o custo uniforme (sem k símbolos válidos antes)
+    STAT_SEQUENCES_ABANDONED,   // sequências abandonadas no top-N (MetaClass::computeNRCBounded)
+    STAT_COUNTER_COUNT
+};
+
+#ifdef NO_STATS
+
+inline void statsAdd(StatCounter, uint64_t) {}
+
+// Só para avisar, com --stats, que não há estatísticas
+inline bool &statsRequested() {
+    static bool requested = false;
+    return requested;
+}
+inline void statsEnable() { statsRequested() = true; }
+inline bool statsEnabled() { return statsRequested(); }
+inline void statsReport(ostream &out) { out << "Estatísticas indisponíveis (compilado com -DNO_STATS)" << endl; }
+
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char *) {}
+    void stop() {}
+};
+
+#else
+
+extern atomic<uint64_t> STAT_COUNTERS[STAT_COUNTER_COUNT];
+
+inline void statsAdd(StatCounter counter, uint64_t value) {
+    STAT_COUNTERS[counter].fetch_add(value, memory_order_relaxed);
+}
+
+// Ativa o relatório (--stats); os contadores são sempre acumulados
+void statsEnable();
+bool statsEnabled();
+
+// Tempo de cada fase, contadores, tempo total e pico de memória
+void statsReport(ostream &out);
+
+// Soma à fase phase o tempo entre a construção e stop() (ou a destruição).
+// As fases aparecem no relatório pela ordem em que terminam pela primeira vez
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char *phase);
+    ~ScopedTimer();
+    void stop();
+
+private:
+    const char *phase;
+    chrono::steady_clock::time_point start;
+    bool running;
+};
+
+#endif
+
+// Escreve o relatório em stderr no fim do âmbito (i.e. ao sair de main) se
+// --stats foi pedido
+struct StatsReporter {
+    ~StatsReporter();
+};
+
+#endif
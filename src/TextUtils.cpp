@@ -0,0 +1,19 @@
+#include "TextUtils.hpp"
+#include <cctype>
+
+using namespace std;
+
+void trim(string &s) {
+    while (!s.empty() && isspace(static_cast<unsigned char>(s.back())))
+        s.pop_back();
+}
+
+string csvQuote(const string &field) {
+    string quoted = "\"";
+    for (char c : field) {
+        if (c == '"')
+            quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
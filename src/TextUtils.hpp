@@ -0,0 +1,15 @@
+#ifndef TEXTUTILS_HPP
+#define TEXTUTILS_HPP
+
+#include <string>
+
+using namespace std;
+
+// Remove espaços e quebras de linha do fim da string
+void trim(string &s);
+
+// Campo CSV entre aspas, com as aspas interiores duplicadas (os identificadores
+// podem conter vírgulas)
+string csvQuote(const string &field);
+
+#endif
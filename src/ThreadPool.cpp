@@ -0,0 +1,150 @@
+#include "ThreadPool.hpp"
+#include <algorithm>
+
+using namespace std;
+
+// Índice do worker que executa a thread atual (-1 fora do pool)
+static thread_local int currentWorker = -1;
+static thread_local const ThreadPool *currentPool = nullptr;
+
+ThreadPool::ThreadPool(unsigned numThreads)
+    : nextQueue(0), queued(0), pending(0), stopping(false) {
+    if (numThreads == 0)
+        numThreads = max(1u, thread::hardware_concurrency());
+    for (unsigned i = 0; i < numThreads; i++)
+        queues.push_back(make_unique<WorkerQueue>());
+    for (unsigned i = 0; i < numThreads; i++)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (thread &t : workers)
+        t.join();
+}
+
+unsigned ThreadPool::size() const {
+    return workers.size();
+}
+
+void ThreadPool::submit(function<void()> task) {
+    size_t target;
+    if (currentPool == this && currentWorker >= 0)
+        target = currentWorker;
+    else
+        target = nextQueue.fetch_add(1, memory_order_relaxed) % queues.size();
+    // A tarefa é contada antes de entrar na fila: um worker que a retire logo a seguir
+    // já encontra queued e pending incrementados (senão decrementá-los-ia abaixo de zero)
+    {
+        lock_guard<mutex> lock(stateMutex);
+        queued++;
+        pending++;
+    }
+    {
+        lock_guard<mutex> lock(queues[target]->m);
+        queues[target]->tasks.push_back(move(task));
+    }
+    workAvailable.notify_one();
+}
+
+bool ThreadPool::tryPop(unsigned id, function<void()> &task) {
+    // Primeiro a própria fila (LIFO), depois roubo às restantes (FIFO)
+    {
+        WorkerQueue &own = *queues[id];
+        lock_guard<mutex> lock(own.m);
+        if (!own.tasks.empty()) {
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkerQueue &victim = *queues[(id + offset) % queues.size()];
+        lock_guard<mutex> lock(victim.m);
+        if (!victim.tasks.empty()) {
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::workerLoop(unsigned id) {
+    currentWorker = id;
+    currentPool = this;
+    while (true) {
+        function<void()> task;
+        if (tryPop(id, task)) {
+            {
+                lock_guard<mutex> lock(stateMutex);
+                queued--;
+            }
+            try {
+                task();
+            } catch (...) {
+                lock_guard<mutex> lock(stateMutex);
+                if (!firstError)
+                    firstError = current_exception();
+            }
+            lock_guard<mutex> lock(stateMutex);
+            if (--pending == 0)
+                allDone.notify_all();
+            continue;
+        }
+        unique_lock<mutex> lock(stateMutex);
+        workAvailable.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;
+    }
+}
+
+void ThreadPool::wait() {
+    unique_lock<mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return pending == 0; });
+    if (firstError) {
+        exception_ptr error = firstError;
+        firstError = nullptr;
+        rethrow_exception(error);
+    }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const function<void(size_t)> &body) {
+    if (begin >= end)
+        return;
+    // Blocos mais pequenos que o necessário para que o roubo equilibre a carga
+    size_t chunks = min(end - begin, static_cast<size_t>(size()) * 4);
+    size_t chunkSize = (end - begin + chunks - 1) / chunks;
+
+    // Espera só pelos seus blocos (e não por wait()), para que várias threads
+    // possam usar o pool ao mesmo tempo
+    mutex doneMutex;
+    condition_variable done;
+    size_t remaining = (end - begin + chunkSize - 1) / chunkSize;
+    exception_ptr error;
+    for (size_t start = begin; start < end; start += chunkSize) {
+        size_t stop = min(end, start + chunkSize);
+        submit([start, stop, &body, &doneMutex, &done, &remaining, &error] {
+            exception_ptr chunkError;
+            try {
+                for (size_t i = start; i < stop; i++)
+                    body(i);
+            } catch (...) {
+                chunkError = current_exception();
+            }
+            lock_guard<mutex> lock(doneMutex);
+            if (chunkError && !error)
+                error = chunkError;
+            if (--remaining == 0)
+                done.notify_all();
+        });
+    }
+    unique_lock<mutex> lock(doneMutex);
+    done.wait(lock, [&remaining] { return remaining == 0; });
+    if (error)
+        rethrow_exception(error);
+}
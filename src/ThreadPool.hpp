@@ -0,0 +1,63 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Conjunto de threads com roubo de trabalho: cada worker tem a sua própria fila,
+// consome tarefas do fim dela e, quando fica sem trabalho, rouba do início das
+// filas dos outros. As tarefas submetidas por um worker vão para a sua fila.
+class ThreadPool {
+public:
+    // numThreads == 0 usa o número de núcleos disponíveis
+    explicit ThreadPool(unsigned numThreads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(function<void()> task);
+
+    // Bloqueia até todas as tarefas submetidas terminarem; relança a primeira
+    // exceção lançada por uma tarefa
+    void wait();
+
+    unsigned size() const;
+
+    // Executa body(i) para i em [begin, end) repartido em blocos pelos workers.
+    // Espera apenas pelos seus blocos, pelo que pode ser chamada em simultâneo
+    // por várias threads fora do pool; relança a primeira exceção de body
+    void parallelFor(size_t begin, size_t end, const function<void(size_t)> &body);
+
+private:
+    struct WorkerQueue {
+        mutex m;
+        deque<function<void()>> tasks;
+    };
+
+    vector<unique_ptr<WorkerQueue>> queues;
+    vector<thread> workers;
+    atomic<size_t> nextQueue;
+
+    mutex stateMutex;
+    condition_variable workAvailable;
+    condition_variable allDone;
+    size_t queued;
+    size_t pending;
+    bool stopping;
+    exception_ptr firstError;
+
+    void workerLoop(unsigned id);
+    bool tryPop(unsigned id, function<void()> &task);
+};
+
+#endif
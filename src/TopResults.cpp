@@ -0,0 +1,37 @@
+#include "TopResults.hpp"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+TopResults::TopResults(size_t capacity)
+    : capacity(capacity),
+      worst(capacity == 0 ? -numeric_limits<double>::infinity() : numeric_limits<double>::infinity()) {}
+
+double TopResults::limit() const {
+    return worst.load(memory_order_relaxed);
+}
+
+void TopResults::offer(double nrc, size_t record) {
+    TopEntry entry{nrc, record};
+    lock_guard<mutex> lock(heapMutex);
+    if (heap.size() < capacity) {
+        heap.push_back(entry);
+        push_heap(heap.begin(), heap.end());
+    } else if (capacity > 0 && entry < heap.front()) {
+        pop_heap(heap.begin(), heap.end());
+        heap.back() = entry;
+        push_heap(heap.begin(), heap.end());
+    } else {
+        return;
+    }
+    if (heap.size() == capacity)
+        worst.store(heap.front().nrc, memory_order_relaxed);
+}
+
+vector<TopEntry> TopResults::sorted() const {
+    lock_guard<mutex> lock(heapMutex);
+    vector<TopEntry> entries = heap;
+    sort_heap(entries.begin(), entries.end());
+    return entries;
+}
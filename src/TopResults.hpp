@@ -0,0 +1,43 @@
+#ifndef TOPRESULTS_HPP
+#define TOPRESULTS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+// Candidato ao top-N: NRC e posição na base de dados, que desempata como a
+// ordenação estável pelo NRC
+struct TopEntry {
+    double nrc;
+    size_t record;
+
+    bool operator<(const TopEntry &other) const {
+        return nrc < other.nrc || (nrc == other.nrc && record < other.record);
+    }
+};
+
+// Os capacity melhores resultados, num max-heap limitado partilhado pelos workers.
+// limit() é o NRC acima do qual uma sequência já não pode entrar, usado para
+// abandonar cedo a pontuação das restantes (MetaClass::computeNRCBounded)
+class TopResults {
+public:
+    explicit TopResults(size_t capacity);
+
+    double limit() const;
+
+    void offer(double nrc, size_t record);
+
+    // Resultados por ordem crescente de NRC
+    vector<TopEntry> sorted() const;
+
+private:
+    size_t capacity;
+    vector<TopEntry> heap;
+    mutable mutex heapMutex;
+    atomic<double> worst;
+};
+
+#endif
@@ -0,0 +1,100 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <random>
+#include <cmath>
+#include "MetaClass.hpp"
+
+using namespace std;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -m <model_file> -a <smoothing_parameter> [-n <symbols>] [-r <repetitions>]" << endl;
+    cout << "Example: " << progName << " -m models/k13.bin -a 0.01 -n 10000000" << endl;
+}
+
+// Gera uma sequência ACGT pseudo-aleatória reprodutível
+string randomSequence(size_t length) {
+    static const char NUCLEOTIDES[] = "ACGT";
+    mt19937_64 rng(42);
+    string seq(length, 'A');
+    for (size_t i = 0; i < length; i++)
+        seq[i] = NUCLEOTIDES[rng() & 3];
+    return seq;
+}
+
+// Pontua a sequência várias vezes e devolve o melhor tempo em segundos
+double timeScoring(const MetaClass &model, const string &seq, double a, int repetitions, double &nrc) {
+    double best = 0.0;
+    for (int r = 0; r < repetitions; r++) {
+        auto start = chrono::steady_clock::now();
+        nrc = model.computeNRC(seq, a);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+    }
+    return best;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string modelFilename;
+    double a = -1.0;
+    size_t length = 10000000;
+    int repetitions = 3;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-m" && i + 1 < argc) {
+            modelFilename = argv[++i];
+        } else if (arg == "-a" && i + 1 < argc) {
+            a = atof(argv[++i]);
+        } else if (arg == "-n" && i + 1 < argc) {
+            length = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-r" && i + 1 < argc) {
+            repetitions = max(1, atoi(argv[++i]));
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (a <= 0) {
+        cerr << "O valor de alpha deve ser positivo." << endl;
+        return 1;
+    }
+
+    MetaClass model;
+    if (!model.loadModel(modelFilename) || model.isCompiled()) {
+        cerr << "É necessário um modelo de contagens não compilado" << endl;
+        return 1;
+    }
+
+    string seq = randomSequence(length);
+
+    double nrcCounts = 0.0;
+    double countsTime = timeScoring(model, seq, a, repetitions, nrcCounts);
+
+    auto start = chrono::steady_clock::now();
+    // compile() falha, por exemplo, com modelos esparsos: sem tabela de custos não há
+    // nada a comparar
+    if (!model.compile(a))
+        return 1;
+    double compileTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double nrcCompiled = 0.0;
+    double compiledTime = timeScoring(model, seq, a, repetitions, nrcCompiled);
+
+    cout << "k = " << model.k << ", alpha = " << a << ", " << length << " símbolos" << endl;
+    cout << "Contagens:  " << length / countsTime << " símbolos/s (NRC " << nrcCounts << ")" << endl;
+    cout << "Compilado:  " << length / compiledTime << " símbolos/s (NRC " << nrcCompiled << ")" << endl;
+    cout << "Compilação: " << compileTime << " s" << endl;
+    cout << "Aceleração: " << countsTime / compiledTime << "x" << endl;
+    cout << "Diferença no NRC: " << fabs(nrcCounts - nrcCompiled) << endl;
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <unistd.h>
+#include "ScoreProtocol.hpp"
+
+using namespace std;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -s <socket_path> -a <alpha> [-c <clients>] [-r <requests>] [-b <batch>] [-n <symbols>] [-t <k_top>]" << endl;
+    cout << "Example: " << progName << " -s /tmp/nrc.sock -a 0.01 -c 4 -r 50 -b 16 -n 10000" << endl;
+}
+
+// Pedido SCORE (ou TOP, se top >= 0) com batch sequências ACGT pseudo-aleatórias
+string makeRequest(mt19937_64 &rng, double a, long top, size_t batch, size_t length) {
+    static const char NUCLEOTIDES[] = "ACGT";
+    ostringstream text;
+    text << setprecision(17);
+    if (top >= 0)
+        text << "TOP " << a << " " << top << " " << batch << "\n";
+    else
+        text << "SCORE " << a << " " << batch << "\n";
+    string seq(length, 'A');
+    for (size_t i = 0; i < batch; i++) {
+        for (size_t p = 0; p < length; p++)
+            seq[p] = NUCLEOTIDES[rng() & 3];
+        text << "q" << i << "\t" << seq << "\n";
+    }
+    return text.str();
+}
+
+// Envia os pedidos de um cliente, um de cada vez, e regista a latência de cada um
+void runClient(const string &socketPath, const vector<string> &requests, vector<double> &latencies) {
+    int fd = connectUnixSocket(socketPath);
+    LineChannel channel(fd, fd);
+    string line;
+    for (const string &request : requests) {
+        auto start = chrono::steady_clock::now();
+        channel.write(request);
+        channel.flush();
+        if (!channel.readLine(line) || line.compare(0, 3, "OK ") != 0)
+            throw runtime_error("Resposta inválida do servidor: " + line);
+        size_t lines = strtoull(line.c_str() + 3, nullptr, 10);
+        for (size_t i = 0; i < lines; i++)
+            channel.readLine(line);
+        latencies.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    }
+    channel.write("QUIT\n");
+    channel.flush();
+    close(fd);
+}
+
+double percentile(const vector<double> &sorted, double p) {
+    size_t index = min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5));
+    return sorted[index];
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string socketPath;
+    double a = -1.0;
+    int clients = 4;
+    int requestsPerClient = 50;
+    size_t batch = 16;
+    size_t length = 10000;
+    long top = -1;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "-a" && i + 1 < argc) {
+            a = atof(argv[++i]);
+        } else if (arg == "-c" && i + 1 < argc) {
+            clients = max(1, atoi(argv[++i]));
+        } else if (arg == "-r" && i + 1 < argc) {
+            requestsPerClient = max(1, atoi(argv[++i]));
+        } else if (arg == "-b" && i + 1 < argc) {
+            batch = max(1ul, strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "-n" && i + 1 < argc) {
+            length = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-t" && i + 1 < argc) {
+            top = atol(argv[++i]);
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (socketPath.empty() || a < 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Os pedidos são gerados antes de medir, com uma semente por cliente
+    vector<vector<string>> requests(clients);
+    for (int c = 0; c < clients; c++) {
+        mt19937_64 rng(42 + c);
+        for (int r = 0; r < requestsPerClient; r++)
+            requests[c].push_back(makeRequest(rng, a, top, batch, length));
+    }
+
+    vector<vector<double>> latencies(clients);
+    vector<string> errors(clients);
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int c = 0; c < clients; c++) {
+        threads.emplace_back([&, c] {
+            try {
+                runClient(socketPath, requests[c], latencies[c]);
+            } catch (const exception &e) {
+                errors[c] = e.what();
+            }
+        });
+    }
+    for (thread &t : threads)
+        t.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    for (const string &error : errors) {
+        if (!error.empty()) {
+            cerr << error << endl;
+            return 1;
+        }
+    }
+
+    vector<double> all;
+    for (const vector<double> &client : latencies)
+        all.insert(all.end(), client.begin(), client.end());
+    sort(all.begin(), all.end());
+    size_t totalRequests = all.size();
+    double sequences = static_cast<double>(totalRequests) * batch;
+
+    cout << clients << " clientes x " << requestsPerClient << " pedidos de " << batch << " sequências de "
+         << length << " símbolos (" << (top >= 0 ? "TOP" : "SCORE") << ")" << endl;
+    cout << "Tempo total: " << elapsed << " s" << endl;
+    cout << "Débito:      " << totalRequests / elapsed << " pedidos/s, " << sequences / elapsed << " sequências/s, "
+         << sequences * length / elapsed << " símbolos/s" << endl;
+    cout << fixed << setprecision(3);
+    cout << "Latência (ms): p50 " << 1e3 * percentile(all, 0.5) << ", p95 " << 1e3 * percentile(all, 0.95)
+         << ", p99 " << 1e3 * percentile(all, 0.99) << ", máx " << 1e3 * all.back() << endl;
+    return 0;
+}
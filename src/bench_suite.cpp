@@ -0,0 +1,354 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <stdexcept>
+#include <functional>
+#include <filesystem>
+#include <thread>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "MetaClass.hpp"
+#include "ContextCounter.hpp"
+#include "Levenshtein.hpp"
+#include "Nucleotide.hpp"
+#include "SequenceDb.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// As fases micro guardam tabelas densas de 4^(k+1) entradas de 4 bytes (16 * 4^k
+// bytes cada, até duas em memória: contagens e custos compilados): ~0.5 GiB para
+// k = 12 e ~2 GiB para k = 13; k = 14 já precisaria de ~8 GiB
+const int MAX_BENCH_K = 13;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -meta <meta_file> -db <db_file> [-bin <bin_dir>] [-dir <work_dir>] [-k <k>] [-a <alpha>] [-j <threads>] [-r <repetitions>] [-pairs <n>] [-o <output_json>]" << endl;
+    cout << "  -k: 1 to " << MAX_BENCH_K << " (default 12); the in-process phases need ~0.5 GiB at k = 12 and ~2 GiB at k = 13" << endl;
+    cout << "Example: " << progName << " -meta bench_data/meta.txt -db bench_data/db.txt -bin src/bin -dir bench_data -o bench_data/results.json" << endl;
+}
+
+// Resultado de uma fase: tempo, símbolos processados e pico de memória do
+// processo (micro) ou do programa executado (macro)
+struct BenchResult {
+    string name;
+    string command;
+    double seconds;
+    double userSeconds;
+    double systemSeconds;
+    double symbols;
+    double cells;               // células da matriz de edição (Levenshtein)
+    long peakRssKb;
+    int exitCode;
+};
+
+// Pico de memória residente deste processo, em KiB
+long peakRssKb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Executa body repetitions vezes e regista o melhor tempo
+BenchResult timePhase(const string &name, int repetitions, double symbols, const function<void()> &body) {
+    double best = 0.0;
+    for (int r = 0; r < repetitions; r++) {
+        auto start = chrono::steady_clock::now();
+        body();
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (r == 0 || elapsed < best)
+            best = elapsed;
+    }
+    cerr << name << ": " << best << " s" << endl;
+    return BenchResult{name, "", best, 0.0, 0.0, symbols, 0.0, peakRssKb(), 0};
+}
+
+// Executa um dos programas com a diretoria de trabalho dir (a saída vai para
+// <dir>/<nome>.log) e mede o tempo, o tempo de CPU e o pico de memória
+BenchResult runProgram(const string &name, const string &dir, const vector<string> &args, double symbols) {
+    string command;
+    for (const string &arg : args)
+        command += (command.empty() ? "" : " ") + arg;
+    string logFilename = dir + "/" + name + ".log";
+
+    auto start = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0)
+        throw runtime_error("Erro ao criar o processo para " + name);
+    if (pid == 0) {
+        int log = open(logFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (log < 0 || chdir(dir.c_str()) != 0)
+            _exit(127);
+        dup2(log, STDOUT_FILENO);
+        dup2(log, STDERR_FILENO);
+        vector<char *> argv;
+        for (const string &arg : args)
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    rusage usage{};
+    wait4(pid, &status, 0, &usage);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    int exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    cerr << name << ": " << elapsed << " s" << (exitCode ? " (falhou, ver " + logFilename + ")" : "") << endl;
+    return BenchResult{name, command, elapsed,
+                       usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6,
+                       usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6,
+                       symbols, 0.0, usage.ru_maxrss, exitCode};
+}
+
+string jsonString(const string &text) {
+    ostringstream out;
+    out << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if (c < 0x20)
+            out << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec;
+        else
+            out << c;
+    }
+    out << '"';
+    return out.str();
+}
+
+void writeResults(ostream &out, const vector<BenchResult> &results, bool macro) {
+    out << "[";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        out << (i ? "," : "") << "\n    {\"name\": " << jsonString(r.name);
+        if (macro)
+            out << ", \"command\": " << jsonString(r.command) << ", \"exit_code\": " << r.exitCode
+                << ", \"user_seconds\": " << r.userSeconds << ", \"system_seconds\": " << r.systemSeconds;
+        out << ", \"seconds\": " << r.seconds << ", \"symbols\": " << r.symbols
+            << ", \"symbols_per_sec\": " << (r.seconds > 0 ? r.symbols / r.seconds : 0.0);
+        if (r.cells > 0)
+            out << ", \"cells\": " << r.cells << ", \"cells_per_sec\": " << (r.seconds > 0 ? r.cells / r.seconds : 0.0);
+        out << ", \"peak_rss_kb\": " << r.peakRssKb << "}";
+    }
+    out << (results.empty() ? "]" : "\n  ]");
+}
+
+// Referência só com ACGT, como em models_generator
+string readMeta(const string &filename) {
+    ifstream in(filename, ios::binary);
+    if (!in)
+        throw runtime_error("Erro ao abrir o arquivo " + filename);
+    string meta;
+    char buffer[1 << 16];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        forEachNucleotide(buffer, in.gcount(), [&meta](size_t, int sym) {
+            if (sym != NUCLEOTIDE_INVALID)
+                meta.push_back("ACGT"[sym]);
+        });
+    }
+    return meta;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string metaFilename, dbFilename;
+    string binDir = "src/bin";
+    string workDir = "bench_data";
+    string outputFilename = "-";
+    int k = 12;
+    double a = 0.01;
+    unsigned threads = 0;
+    int repetitions = 3;
+    size_t pairs = 4;
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-meta" && i + 1 < argc) {
+            metaFilename = argv[++i];
+        } else if (arg == "-db" && i + 1 < argc) {
+            dbFilename = argv[++i];
+        } else if (arg == "-bin" && i + 1 < argc) {
+            binDir = argv[++i];
+        } else if (arg == "-dir" && i + 1 < argc) {
+            workDir = argv[++i];
+        } else if (arg == "-k" && i + 1 < argc) {
+            k = atoi(argv[++i]);
+        } else if (arg == "-a" && i + 1 < argc) {
+            a = atof(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "-r" && i + 1 < argc) {
+            repetitions = max(1, atoi(argv[++i]));
+        } else if (arg == "-pairs" && i + 1 < argc) {
+            pairs = strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (metaFilename.empty() || dbFilename.empty() || k <= 0 || k > MAX_BENCH_K) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (threads == 0)
+        threads = max(1u, thread::hardware_concurrency());
+
+    vector<BenchResult> micro, macro;
+    try {
+        fs::create_directories(workDir + "/models");
+        // Os programas correm em workDir; os caminhos passam a absolutos
+        string meta = fs::absolute(metaFilename).string();
+        string dbPath = fs::absolute(dbFilename).string();
+        string bin = fs::absolute(binDir).string() + "/";
+
+        // Micro: as funções das bibliotecas, no próprio processo
+        string reference;
+        micro.push_back(timePhase("read_meta", 1, 0, [&] { reference = readMeta(meta); }));
+        micro.back().symbols = reference.size();
+
+        SequenceDb db;
+        if (!db.open(dbPath))
+            return 1;
+        vector<string> sequences;
+        double dbSymbols = 0;
+        micro.push_back(timePhase("read_db", 1, 0, [&] {
+            sequences.clear();
+            for (size_t i = 0; i < db.size(); i++)
+                sequences.push_back(db.sequence(i));
+        }));
+        for (const string &seq : sequences)
+            dbSymbols += seq.size();
+        micro.back().symbols = dbSymbols;
+        if (sequences.size() < 2)
+            throw runtime_error("A base de dados precisa de pelo menos 2 sequências");
+
+        vector<int> counts;
+        micro.push_back(timePhase("count_contexts", repetitions, reference.size(), [&] {
+            counts = countContexts(reference, k);
+        }));
+        if (threads > 1) {
+            micro.push_back(timePhase("count_contexts_j" + to_string(threads), repetitions, reference.size(), [&] {
+                counts = countContexts(reference, k, threads);
+            }));
+        }
+
+        MetaClass model;
+        model.setK(k);
+        model.setCounts(counts);
+        vector<int>().swap(counts);
+        volatile double sink = 0;
+        micro.push_back(timePhase("score_nrc", repetitions, dbSymbols, [&] {
+            for (const string &seq : sequences)
+                sink = sink + model.computeNRC(seq, a);
+        }));
+        micro.push_back(timePhase("score_nrc_alpha_sweep_4", repetitions, dbSymbols, [&] {
+            vector<double> alphas = {a / 10, a, a * 10, a * 100};
+            for (const string &seq : sequences)
+                sink = sink + model.computeNRCs(seq, alphas)[0];
+        }));
+        micro.push_back(timePhase("complexity_profile", repetitions, dbSymbols, [&] {
+            for (const string &seq : sequences)
+                sink = sink + model.positionCosts(seq, a).size();
+        }));
+        micro.push_back(timePhase("compile_model", 1, 0, [&] { model.compile(a); }));
+        micro.push_back(timePhase("score_nrc_compiled", repetitions, dbSymbols, [&] {
+            for (const string &seq : sequences)
+                sink = sink + model.computeNRC(seq, a);
+        }));
+
+        // Distâncias de edição entre a primeira sequência e as seguintes
+        size_t comparisons = min(pairs, sequences.size() - 1);
+        double levSymbols = 0, levCells = 0;
+        for (size_t i = 1; i <= comparisons; i++) {
+            levSymbols += sequences[0].size() + sequences[i].size();
+            levCells += static_cast<double>(sequences[0].size()) * sequences[i].size();
+        }
+        micro.push_back(timePhase("levenshtein", repetitions, levSymbols, [&] {
+            for (size_t i = 1; i <= comparisons; i++)
+                sink = sink + levenshteinDistance(sequences[0], sequences[i]);
+        }));
+        micro.back().cells = levCells;
+
+        // Liberta as tabelas do modelo antes de correr os programas, que carregam as suas
+        model = MetaClass();
+
+        // Macro: cada programa completo, incluindo a leitura dos ficheiros
+        string kText = to_string(k);
+        ostringstream alphaText;
+        alphaText << a;
+        string alpha = alphaText.str();
+        string j = to_string(threads);
+        string model_file = "models/k" + kText + ".bin";
+        string id1 = db.id(0), id2 = db.id(1);
+        // -dense: a escolha automática pode dar um modelo esparso, que models_compiler
+        // não compila, e as fases seguintes precisam de models/compiled.bin
+        macro.push_back(runProgram("models_generator", workDir,
+            {bin + "models_generator.out", "-meta", meta, "-k", kText, "-dense", "-j", j}, reference.size()));
+        macro.push_back(runProgram("models_compiler", workDir,
+            {bin + "models_compiler.out", "-m", model_file, "-a", alpha, "-o", "models/compiled.bin"}, 0));
+        macro.push_back(runProgram("db_pack", workDir,
+            {bin + "db_pack.out", "-db", dbPath, "-o", "db.pack"}, dbSymbols));
+        macro.push_back(runProgram("main_top", workDir,
+            {bin + "main.out", "-db", dbPath, "-m", model_file, "-a", alpha, "-t", "10", "-j", j}, dbSymbols));
+        macro.push_back(runProgram("main_top_packed_compiled", workDir,
+            {bin + "main.out", "-db", "db.pack", "-m", "models/compiled.bin", "-a", alpha, "-t", "10", "-j", j}, dbSymbols));
+        macro.push_back(runProgram("main_sweep", workDir,
+            {bin + "main.out", "-db", dbPath, "-m", model_file, "-a", "0.001,0.01,0.1,1", "-o", "sweep.csv", "-j", j},
+            dbSymbols));
+        macro.push_back(runProgram("similarities_levenshtein", workDir,
+            {bin + "similarities_levenshtein.out", "-db", dbPath, "-id1", id1, "-id2", id2},
+            static_cast<double>(db.length(0) + db.length(1))));
+        macro.push_back(runProgram("similarities_models", workDir,
+            {bin + "similarities_models.out", "-db", dbPath, "-id1", id1, "-id2", id2, "-a", alpha, "-k", kText},
+            static_cast<double>(db.length(0) + db.length(1))));
+        macro.push_back(runProgram("complexity_profile", workDir,
+            {bin + "complexity_profile.out", "-db", dbPath, "-id", id1, "-a", alpha, "-m", model_file, "-o", "profile.bin"},
+            static_cast<double>(db.length(0))));
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    ofstream file;
+    if (outputFilename != "-") {
+        file.open(outputFilename);
+        if (!file) {
+            cerr << "Erro ao criar o ficheiro de saída: " << outputFilename << endl;
+            return 1;
+        }
+    }
+    ostream &out = outputFilename == "-" ? cout : file;
+    out << setprecision(6);
+    out << "{\n  \"timestamp\": " << time(nullptr)
+        << ",\n  \"config\": {\"meta\": " << jsonString(metaFilename) << ", \"db\": " << jsonString(dbFilename)
+        << ", \"k\": " << k << ", \"alpha\": " << a << ", \"threads\": " << threads
+        << ", \"repetitions\": " << repetitions << ", \"nucleotide_kernel\": " << jsonString(nucleotideKernel()) << "}"
+        << ",\n  \"micro\": ";
+    writeResults(out, micro, false);
+    out << ",\n  \"macro\": ";
+    writeResults(out, macro, true);
+    out << "\n}\n";
+
+    for (const BenchResult &r : macro) {
+        if (r.exitCode != 0) {
+            cerr << "Falhou: " << r.name << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
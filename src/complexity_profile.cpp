@@ -2,176 +2,423 @@
 #include <fstream>
 #include <sstream>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
 #include <cmath>
 #include <vector>
 #include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include "MetaClass.hpp"
+#include "ContextCounter.hpp"
+#include "BufferedWriter.hpp"
+#include "SequenceDb.hpp"
+#include "ThreadPool.hpp"
+#include "Stats.hpp"
+#include "TextUtils.hpp"
 
 using namespace std;
 
-using ContextMap = unordered_map<string, unordered_map<char, int>>;
-
 void printUsage(const string& progName) {
-    cout << "Usage: " << progName << " -meta <meta_file> -db <db_file> -id <sequence_id> -k <context_size> -a <smoothing_parameter>" << endl;
+    cout << "Usage: " << progName << " -db <db_file> -id <sequence_id> -a <smoothing_parameter> (-m <model_file> | -meta <meta_file> -k <context_size>) [-format bin|csv] [-o <output_file>] [--stats]" << endl;
+    cout << "       " << progName << " -db <db_file> (-id <sequence_id> | -all) -a <smoothing_parameter> (-m <model_file> | -meta <meta_file> -k <context_size>) [-w <window>[,<window>...]] [-low <bits>] [-high <bits>] [-minlen <symbols>] [-summary <file>] [-segments <file>] [-j <threads>]" << endl;
     cout << "Example: " << progName << "-meta txt_files/meta.txt -db txt_files/db.txt -k 10 -a 0.01 -id 'NC_005831.2 Human Coronavirus NL63, complete genome'" << endl;
+    cout << "Example: " << progName << "-m models/k10.bin -db txt_files/db.txt -a 0.01 -id 'NC_005831.2 Human Coronavirus NL63, complete genome'" << endl;
+    cout << "Example: " << progName << "-m models/k10.bin -db txt_files/db.txt -a 0.01 -all -w 100,1000 -low 1.6 -summary analysis/resumo.csv -segments analysis/segmentos.csv" << endl;
 }
 
 
-double calculateAverageInformation(const unordered_map<string, unordered_map<char, int>>& contextCounts, const string& text, int k, double alpha) {
-    unordered_set<char> alphabet(text.begin(), text.end());
-    int alphabetSize = alphabet.size();
-
+// Cabeçalho do perfil binário. Seguem-se os idLength bytes do identificador e
+// count valores float32 com o custo das posições k, k + 1, ..., sequenceLength - 1
+struct ProfileHeader {
+    char magic[4];              // "TAIP"
+    uint32_t version;
+    int32_t k;
+    uint32_t idLength;
+    double alpha;
+    uint64_t sequenceLength;
+    uint64_t count;
+};
+
+double calculateAverageInformation(const vector<double>& costs) {
+    if (costs.empty())
+        return 0.0;
     double totalInfo = 0.0;
-    int countSymbols = text.size() - k;
-
-    for (size_t i = k; i < text.size(); i++) {
-        string context = text.substr(i - k, k);
-        char symbol = text[i];
-
-        auto it = contextCounts.find(context);
-        if (it == contextCounts.end()) continue;
-
-        int totalCount = 0;
-        int symbolCount = 0;
-
-        auto freqIt = it->second.find(symbol);
-        if (freqIt != it->second.end()) {
-            symbolCount = freqIt->second;
-        }
-
-        for (const auto& [_, count] : it->second) {
-            totalCount += count;
-        }
-
-        double probability = ( symbolCount + alpha) / (totalCount + alpha * alphabetSize);
-        double logProb = -log2(probability);
-
+    for (double logProb : costs)
         totalInfo += logProb;
-    
-        cout << i << " " << logProb << " " << symbol << endl;
-    }
-    
-    return totalInfo / countSymbols;
+    return totalInfo / costs.size();
 }
 
-string read_fasta_sequence(ifstream& file, const string& target_id) {
-    string line, sequence, current_id;
-    bool found = false;
-
-    while (getline(file, line)) {
-        if (line[0] == '@') {
-            if (line.substr(1).find(target_id) != string::npos) {
-                found = true;
-                sequence.clear();
-                current_id = line.substr(1);
-            } else {
-                found = false;
-            }
-        } else if (found) {
-            sequence += line;
-        }
+// Sequência com o identificador dado; se nenhum for igual, usa o último que o contém
+string read_fasta_sequence(const SequenceDb& db, const string& target_id) {
+    long record = db.find(target_id);
+    for (size_t i = 0; record < 0 && i < db.size(); i++) {
+        size_t r = db.size() - 1 - i;
+        if (db.id(r).find(target_id) != string::npos)
+            record = r;
     }
-
-    if (sequence.empty()) {
+    if (record < 0) {
         cerr << "ID \"" << target_id << "\" não encontrado.\n";
         exit(1);
     }
-
-    return sequence;
+    return db.sequence(record);
 }
 
 string read_meta_sequence(const string& filename) {
     ifstream file(filename);
     string line, sequence;
     while (getline(file, line)) {
+        statsAdd(STAT_BYTES_READ, line.size() + 1);
         sequence += line;
     }
     return sequence;
 }
 
-int train_markov_model(ContextMap& model, const string& text, int k) {
-    for (size_t i = 0; i + k < text.size(); ++i) {
-        string context = text.substr(i, k);
-        char next = text[i + k];
-        model[context][next]++;
-    }
-    unordered_set<char> alphabet;
-    for (const auto& [ctx, transitions] : model) {
-        for (const auto& [symbol, _] : transitions) {
-            alphabet.insert(symbol);
-        }
-    }
-    return alphabet.size();
+// Treina o modelo de contexto com as mesmas tabelas inteiras de models_generator
+// (densa ou esparsa, conforme o tamanho da referência)
+void train_markov_model(MetaClass& model, const string& text, int k) {
+    if (preferSparse(text.size(), k))
+        model.setSparseCounts(countContextsSparse(text, k));
+    else
+        model.setCounts(countContexts(text, k));
+    model.setK(k);
 }
 
-double calculate_probability(const ContextMap& model, const string& context, char next, double alpha, int alphabet_size) {
-    if (model.count(context) == 0) {
-        return 1.0 / alphabet_size; 
+// Perfil em CSV (posição,complexidade), com a formatação por omissão dos iostreams (%g)
+void write_profile_csv(const vector<double>& costs, int k, const string& output_file) {
+    BufferedWriter out;
+    out.open(output_file);
+    out.write(string("position,complexity\n"));
+    for (size_t i = 0; i < costs.size(); ++i) {
+        out.print("%zu,%g\n", i + k, costs[i]);
     }
+    out.close();
+}
 
-    const auto& next_counts = model.at(context);
-    double total = 0.0;
-    for (auto& p : next_counts) {
-        total += p.second;
-    }
+// Perfil binário: ProfileHeader, identificador e os custos em float32
+void write_profile_binary(const vector<double>& costs, int k, double alpha, const string& id,
+                          size_t sequenceLength, const string& output_file) {
+    ProfileHeader header = {{'T', 'A', 'I', 'P'}, 1, k, static_cast<uint32_t>(id.size()), alpha,
+                            sequenceLength, costs.size()};
+    vector<float> values(costs.begin(), costs.end());
+
+    BufferedWriter out;
+    out.open(output_file);
+    out.writeValue(header);
+    out.write(id);
+    out.write(values.data(), values.size() * sizeof(float));
+    out.close();
+}
 
-    double count = next_counts.count(next) ? next_counts.at(next) : 0;
-    double vocab = alphabet_size; 
-    return (count + alpha) / (total + alpha * vocab);
+// Parâmetros da análise por janelas: médias móveis de cada tamanho em windows e
+// segmentos cuja média fica abaixo de low ou acima de high (negativos: desligados)
+struct ProfileAnalysis {
+    vector<size_t> windows;
+    double low = -1.0;
+    double high = -1.0;
+    size_t minLength = 0;
+};
+
+// prefix[i] é a soma dos i primeiros custos: a soma de qualquer intervalo custa
+// uma subtração, pelo que todas as janelas de um tamanho são calculadas em O(n)
+vector<double> prefix_sums(const vector<double>& costs) {
+    vector<double> prefix(costs.size() + 1, 0.0);
+    for (size_t i = 0; i < costs.size(); i++)
+        prefix[i + 1] = prefix[i] + costs[i];
+    return prefix;
 }
 
-void generate_complexity_profile(const string& sequence, const ContextMap& model, int k, double alpha, const string& output_csv, int alphabet_size) {
-    ofstream out(output_csv);
-    out << "position,complexity\n";
+// Média dos custos [first, last]
+inline double range_mean(const vector<double>& prefix, size_t first, size_t last) {
+    return (prefix[last + 1] - prefix[first]) / (last + 1 - first);
+}
 
-    for (size_t i = k; i < sequence.size(); ++i) {
-        string context = sequence.substr(i - k, k);
-        char next = sequence[i];
-        double p = calculate_probability(model, context, next, alpha, alphabet_size);
-        double complexity = -log2(p);
-        out << i << "," << complexity << "\n";
-    }
+// Início da janela de w custos que termina no custo i. Só são usadas janelas
+// completas, i.e. que terminam em i >= first_window_end(n, w); num perfil mais
+// curto do que w a única janela é o perfil inteiro
+inline size_t window_start(size_t i, size_t w) {
+    return i + 1 > w ? i + 1 - w : 0;
+}
 
-    cout << "Gráfico gerado em: " << output_csv << endl;
+inline size_t first_window_end(size_t n, size_t w) {
+    return min(n, w) - 1;
 }
 
-int main(int argc, char* argv[]) {
-    if (argc != 11) {
-        printUsage(argv[0]);
-        return 1;
+struct Segment {
+    size_t first, last;        // custos [first, last] (as janelas que o formam)
+    char type;                 // 'L' informação baixa, 'H' alta
+};
+
+// Segmentos de uma janela: cada sequência de janelas com média abaixo de low (ou
+// acima de high) dá a região coberta por essas janelas; regiões do mesmo tipo
+// que se sobreponham são juntas
+vector<Segment> find_segments(const vector<double>& prefix, size_t w, const ProfileAnalysis& analysis) {
+    vector<Segment> segments;
+    const size_t n = prefix.size() - 1;
+    size_t runStart = 0;
+    char state = 0;
+    auto close = [&](size_t end) {
+        if (!state)
+            return;
+        Segment segment{window_start(runStart, w), end, state};
+        for (auto previous = segments.rbegin(); previous != segments.rend(); ++previous) {
+            if (previous->type != state)
+                continue;
+            if (segment.first <= previous->last + 1) {
+                previous->last = end;
+                return;
+            }
+            break;
+        }
+        segments.push_back(segment);
+    };
+    for (size_t i = first_window_end(n, w); i < n; i++) {
+        double mean = range_mean(prefix, window_start(i, w), i);
+        char type = analysis.low >= 0 && mean < analysis.low ? 'L' : analysis.high >= 0 && mean > analysis.high ? 'H' : 0;
+        if (type == state)
+            continue;
+        if (state)
+            close(i - 1);
+        state = type;
+        runStart = i;
     }
+    if (state)
+        close(n - 1);
+    return segments;
+}
 
-    string meta_file, db_file, id;
+// Resumo CSV de um perfil (uma linha por janela) e os seus segmentos. As posições
+// são da sequência: o custo i é o da posição i + k; os segmentos são [start, end)
+void analyse_profile(const string& id, size_t sequenceLength, const vector<double>& costs, int k,
+                     const ProfileAnalysis& analysis, string& summary, string& segmentRows) {
+    ostringstream rows, found;
+    rows << setprecision(10);
+    found << setprecision(10);
+    const string quoted = csvQuote(id);
+    const size_t n = costs.size();
+    if (n == 0)
+        return;
+
+    // Estatísticas do perfil inteiro, como as do notebook (desvio padrão amostral)
+    double minCost = costs[0], maxCost = costs[0];
+    for (double cost : costs) {
+        minCost = min(minCost, cost);
+        maxCost = max(maxCost, cost);
+    }
+    vector<double> prefix = prefix_sums(costs);
+    double mean = prefix[n] / n;
+    double squares = 0.0;
+    for (double cost : costs)
+        squares += (cost - mean) * (cost - mean);
+    double stddev = n > 1 ? sqrt(squares / (n - 1)) : 0.0;
+
+    for (size_t w : analysis.windows) {
+        size_t lowestEnd = 0, highestEnd = 0;
+        double lowest = numeric_limits<double>::infinity(), highest = -lowest;
+        for (size_t i = first_window_end(n, w); i < n; i++) {
+            double windowMean = range_mean(prefix, window_start(i, w), i);
+            if (windowMean < lowest) {
+                lowest = windowMean;
+                lowestEnd = i;
+            }
+            if (windowMean > highest) {
+                highest = windowMean;
+                highestEnd = i;
+            }
+        }
+
+        size_t counts[2] = {0, 0}, bases[2] = {0, 0};
+        for (const Segment& segment : find_segments(prefix, w, analysis)) {
+            size_t length = segment.last + 1 - segment.first;
+            if (length < analysis.minLength)
+                continue;
+            int t = segment.type == 'H';
+            counts[t]++;
+            bases[t] += length;
+            found << quoted << "," << w << "," << segment.type << "," << segment.first + k << ","
+                  << segment.last + 1 + k << "," << range_mean(prefix, segment.first, segment.last) << "\n";
+        }
+
+        rows << quoted << "," << sequenceLength << "," << mean << "," << stddev << "," << minCost << "," << maxCost
+             << "," << w << "," << lowest << "," << lowestEnd + 1 + k << "," << highest << "," << highestEnd + 1 + k
+             << "," << counts[0] << "," << bases[0] << "," << counts[1] << "," << bases[1] << "\n";
+    }
+    summary = rows.str();
+    segmentRows = found.str();
+}
+
+const char* SUMMARY_HEADER = "id,length,mean,std,min,max,window,min_window_mean,min_window_end,max_window_mean,"
+                             "max_window_end,low_segments,low_bases,high_segments,high_bases\n";
+const char* SEGMENTS_HEADER = "id,window,type,start,end,mean\n";
+
+// Grava as linhas de cada sequência pela ordem da base de dados
+void write_rows(const string& filename, const char* header, const vector<string>& rows) {
+    BufferedWriter out;
+    out.open(filename);
+    out.write(string(header));
+    for (const string& row : rows)
+        out.write(row);
+    out.close();
+}
+
+int main(int argc, char* argv[]) {
+    StatsReporter reporter;
+    string meta_file, model_file, db_file, id, output_file;
+    string format = "bin";
     int k = 0;
     double alpha = 0.0;
+    ProfileAnalysis analysis;
+    string summary_file, segments_file;
+    bool all = false;
+    int threads = 0;
 
     for (int i = 1; i < argc; ++i) {
         string arg = argv[i];
-        if (arg == "-meta") {
+        if (arg == "-meta" && i + 1 < argc) {
             meta_file = argv[++i];
-        } else if (arg == "-db") {
+        } else if (arg == "-m" && i + 1 < argc) {
+            model_file = argv[++i];
+        } else if (arg == "-db" && i + 1 < argc) {
             db_file = argv[++i];
-        } else if (arg == "-id") {
+        } else if (arg == "-id" && i + 1 < argc) {
             id = argv[++i];
-        } else if (arg == "-k") {
+        } else if (arg == "-k" && i + 1 < argc) {
             k = stoi(argv[++i]);
-        } else if (arg == "-a") {
+        } else if (arg == "-a" && i + 1 < argc) {
             alpha = stod(argv[++i]);
+        } else if (arg == "-format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            output_file = argv[++i];
+        } else if (arg == "-w" && i + 1 < argc) {
+            stringstream list(argv[++i]);
+            string item;
+            while (getline(list, item, ','))
+                if (!item.empty())
+                    analysis.windows.push_back(strtoull(item.c_str(), nullptr, 10));
+        } else if (arg == "-low" && i + 1 < argc) {
+            analysis.low = stod(argv[++i]);
+        } else if (arg == "-high" && i + 1 < argc) {
+            analysis.high = stod(argv[++i]);
+        } else if (arg == "-minlen" && i + 1 < argc) {
+            analysis.minLength = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-summary" && i + 1 < argc) {
+            summary_file = argv[++i];
+        } else if (arg == "-segments" && i + 1 < argc) {
+            segments_file = argv[++i];
+        } else if (arg == "-all") {
+            all = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--stats" || arg == "-stats") {
+            statsEnable();
         } else {
             printUsage(argv[0]);
             return 1;
         }
     }
 
-    string meta_seq = read_meta_sequence(meta_file);
+    if (db_file.empty() || (id.empty() && !all) || (model_file.empty() && (meta_file.empty() || k <= 0)) ||
+        (format != "bin" && format != "csv") || threads < 0 ||
+        count(analysis.windows.begin(), analysis.windows.end(), 0) > 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    // Sem -w a análise usa a janela do notebook (100)
+    bool analyse = all || !summary_file.empty() || !segments_file.empty() || !analysis.windows.empty();
+    if (analyse && analysis.windows.empty())
+        analysis.windows.push_back(100);
+    if (all && summary_file.empty())
+        summary_file = "-";
+
+    // Um modelo guardado (models/k*.bin) evita treinar a referência em cada execução;
+    // num conjunto de modelos, -k escolhe a ordem
+    ScopedTimer modelTimer(model_file.empty() ? "treinar" : "carregar modelo");
+    MetaClass model;
+    if (!model_file.empty()) {
+        if (!model.loadModel(model_file, k > 0 ? k : -1)) {
+            cerr << "Erro a carregar o modelo" << endl;
+            return 1;
+        }
+        if (model.isCompiled() && model.compiledAlpha() != alpha) {
+            cerr << "O modelo compilado foi gerado com alpha = " << model.compiledAlpha() << endl;
+            return 1;
+        }
+        k = model.k;
+    } else {
+        try {
+            train_markov_model(model, read_meta_sequence(meta_file), k);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    modelTimer.stop();
 
-    ContextMap model;
-    int alphabet_size = train_markov_model(model, meta_seq, k);
+    ScopedTimer openTimer("abrir base de dados");
+    SequenceDb db;
+    if (!db.open(db_file))
+        return 1;
+    openTimer.stop();
+
+    // Todas as sequências, em paralelo: só os resumos e os segmentos saem do processo
+    if (all) {
+        ScopedTimer scoreTimer("pontuar");
+        vector<string> summaries(db.size()), segments(db.size());
+        ThreadPool pool(threads);
+        pool.parallelFor(0, db.size(), [&](size_t record) {
+            string seq = db.sequence(record);
+            vector<double> costs = model.positionCosts(seq, alpha);
+            analyse_profile(db.id(record), seq.size(), costs, k, analysis, summaries[record], segments[record]);
+        });
+        scoreTimer.stop();
+        ScopedTimer outputTimer("escrever resultados");
+        try {
+            write_rows(summary_file, SUMMARY_HEADER, summaries);
+            if (!segments_file.empty())
+                write_rows(segments_file, SEGMENTS_HEADER, segments);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
+    }
 
-    ifstream db(db_file);
     string seq = read_fasta_sequence(db, id);
 
-    generate_complexity_profile(seq, model, k, alpha, "analysis/perfil_complexidade_" + to_string(k) + "_" + to_string(alpha) + "_" + id + ".csv", alphabet_size);
+    if (output_file.empty())
+        output_file = "analysis/perfil_complexidade_" + to_string(k) + "_" + to_string(alpha) + "_" + id + "." + format;
+
+    ScopedTimer scoreTimer("pontuar");
+    vector<double> costs = model.positionCosts(seq, alpha);
+    scoreTimer.stop();
+    ScopedTimer outputTimer("escrever resultados");
+    try {
+        if (format == "csv")
+            write_profile_csv(costs, k, output_file);
+        else
+            write_profile_binary(costs, k, alpha, id, seq.size(), output_file);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    if (analyse) {
+        vector<string> summaries(1), segments(1);
+        analyse_profile(id, seq.size(), costs, k, analysis, summaries[0], segments[0]);
+        try {
+            if (!summary_file.empty())
+                write_rows(summary_file, SUMMARY_HEADER, summaries);
+            if (!segments_file.empty())
+                write_rows(segments_file, SEGMENTS_HEADER, segments);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+    outputTimer.stop();
+
+    cout << "Gráfico gerado em: " << output_file << endl;
+    cout << "Informação média: " << calculateAverageInformation(costs) << " bits/símbolo" << endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,156 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <stdexcept>
+#include "SequenceDb.hpp"
+#include "Nucleotide.hpp"
+
+using namespace std;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -db <db_file> [-o <packed_db_file>]" << endl;
+    cout << "Example: " << progName << " -db txt_files/db.txt -o txt_files/db.pack" << endl;
+}
+
+// Escreve zeros até a posição atual ser múltipla de 8
+void pad8(ofstream& out) {
+    static const char zeros[8] = {};
+    uint64_t position = out.tellp();
+    out.write(zeros, (8 - position % 8) % 8);
+}
+
+// Grava um registo: sequência empacotada a 2 bits, símbolos fora de ACGT e identificador
+DbRecord writeRecord(ofstream& out, const string& id, const string& seq) {
+    DbRecord record{};
+    record.length = seq.size();
+
+    vector<unsigned char> packed((seq.size() + 3) / 4, 0);
+    vector<size_t> invalid;
+    packNucleotides(seq.data(), seq.size(), packed.data(), invalid);
+
+    // Caracteres iguais consecutivos fora de ACGT formam uma única entrada
+    vector<DbRun> runs;
+    for (size_t i : invalid) {
+        unsigned char c = seq[i];
+        if (!runs.empty() && runs.back().symbol == c && runs.back().position + runs.back().length == i &&
+            runs.back().length < UINT32_MAX) {
+            runs.back().length++;
+        } else {
+            DbRun run{};
+            run.position = i;
+            run.length = 1;
+            run.symbol = c;
+            runs.push_back(run);
+        }
+    }
+
+    pad8(out);
+    record.packedOffset = out.tellp();
+    out.write(reinterpret_cast<const char*>(packed.data()), packed.size());
+    pad8(out);
+    record.runsOffset = out.tellp();
+    record.runCount = runs.size();
+    out.write(reinterpret_cast<const char*>(runs.data()), runs.size() * sizeof(DbRun));
+    record.idOffset = out.tellp();
+    record.idLength = id.size();
+    out.write(id.data(), id.size());
+    return record;
+}
+
+// Converte a base de dados em texto para o formato binário de SequenceDb; as
+// sequências são lidas e gravadas uma a uma
+size_t packDatabase(const string& dbFilename, const string& outputFilename) {
+    ifstream in(dbFilename);
+    if (!in)
+        throw runtime_error("Erro ao abrir o ficheiro da base de dados: " + dbFilename);
+    ofstream out(outputFilename, ios::binary);
+    if (!out)
+        throw runtime_error("Erro ao abrir " + outputFilename + " para escrita");
+
+    DbHeader header;
+    memset(&header, 0, sizeof(header));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Só os identificadores e a tabela de registos ficam em memória
+    vector<DbRecord> records;
+    vector<string> ids;
+    readTextDatabase(in, [&](const string& id, const string& seq) {
+        records.push_back(writeRecord(out, id, seq));
+        ids.push_back(id);
+    });
+
+    // Índice com ocupação de no máximo 50%; um identificador repetido fica
+    // associado ao primeiro registo, tal como em SequenceDb::find
+    uint64_t capacity = 16;
+    while (capacity < records.size() * 2)
+        capacity *= 2;
+    const uint64_t mask = capacity - 1;
+    vector<uint64_t> index(capacity, 0);
+    for (size_t i = 0; i < ids.size(); i++) {
+        uint64_t slot = hashId(ids[i].data(), ids[i].size()) & mask;
+        while (index[slot] != 0 && ids[index[slot] - 1] != ids[i])
+            slot = (slot + 1) & mask;
+        if (index[slot] == 0)
+            index[slot] = i + 1;
+    }
+
+    pad8(out);
+    header.recordsOffset = out.tellp();
+    out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(DbRecord));
+    header.indexOffset = out.tellp();
+    header.indexCapacity = capacity;
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(uint64_t));
+
+    memcpy(header.magic, DB_MAGIC, sizeof(header.magic));
+    header.version = DB_FORMAT_VERSION;
+    header.endianTag = MODEL_ENDIAN_TAG;
+    header.count = records.size();
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out)
+        throw runtime_error("Erro a escrever a base de dados em " + outputFilename);
+    return records.size();
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string dbFilename;
+    string outputFilename;
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-db" && i + 1 < argc) {
+            dbFilename = argv[++i];
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (dbFilename.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (outputFilename.empty())
+        outputFilename = dbFilename + ".pack";
+
+    try {
+        size_t count = packDatabase(dbFilename, outputFilename);
+        cout << count << " sequências empacotadas em " << outputFilename << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
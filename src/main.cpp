@@ -5,39 +5,165 @@
 #include <string>
 #include <cstdlib>
 #include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
 #include "MetaClass.hpp"
+#include "ThreadPool.hpp"
+#include "SequenceDb.hpp"
+#include "TopResults.hpp"
+#include "RecordReader.hpp"
+#include "Stats.hpp"
+#include "TextUtils.hpp"
 #include <cctype>
+#include <iomanip>
 
 using namespace std;
 
 void printUsage(const string& progName) {
-    cout << "Usage: " << progName << " -db <db_file> -m <model_file> -a <smoothing_parameter> -t <k_top>" << endl;
+    cout << "Usage: " << progName << " -db <db_file> -m <model_file> -a <smoothing_parameter> -t <k_top> [-k <k>] [-j <threads>] [--stats]" << endl;
+    cout << "       " << progName << " -db <db_file> -m <model_file>[,<model_file>...] -a <alpha>[,<alpha>...] [-k <k>] [-o <output_csv>] [-j <threads>] [--stats]" << endl;
+    cout << "       " << progName << " -db <db_file> -m <model_file>,<model_file>[,...] -a <alpha> -mix <gamma> [-t <k_top>] [-k <k>] [-o <output_csv>] [-j <threads>] [--stats]" << endl;
+    cout << "       " << progName << " -db - -m <model_file> -a <alpha> [-k <k>] [-j <threads>] [-batch <records>] [-ordered] [--stats]" << endl;
     cout << "Example: " << progName << "-db txt_files/db.txt -m models/k13.bin -a 0.01 -t 20" << endl;
+    cout << "Sweep:   " << progName << "-db txt_files/db.txt -m models/k8.bin,models/k13.bin -a 0.001,0.01,0.1,1 -o sweep.csv" << endl;
+    cout << "Stream:  zcat reads.fastq.gz | " << progName << " -db - -m models/k13.bin -a 0.01 -j 0 -ordered" << endl;
+    cout << "Mixture: " << progName << "-db txt_files/db.txt -m models/k8.bin,models/k13.bin -a 0.01 -mix 0.9 -t 20" << endl;
 }
 
-// Estrutura para armazenar os resultados (identificador e NRC) de cada sequência
+// Resultados de cada sequência no modo de varrimento: um NRC por (modelo, alpha)
 struct SequenceResult {
     string id;
-    string seq;
-    double nrc;
+    vector<double> nrcs;
 };
 
-// Função para remover espaços e quebras de linha do fim da string
-void trim(string &s) {
-    while(!s.empty() && isspace(s.back()))
-        s.pop_back();
+// Divide uma lista separada por vírgulas (e.g. "0.001,0.01,0.1")
+vector<string> splitList(const string &list) {
+    vector<string> items;
+    stringstream ss(list);
+    string item;
+    while(getline(ss, item, ','))
+        if(!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+// Lote de registos lidos de stdin, pontuado por uma tarefa do pool
+struct StreamBatch {
+    size_t number;
+    vector<string> ids;
+    vector<string> sequences;
+};
+
+// Modo contínuo (-db -): os registos (FASTA, FASTQ ou da base de dados) são lidos
+// de stdin e cada um é pontuado logo que completo, escrevendo "<id>\t<nrc>".
+// Um lote é despachado quando tem batchSize registos ou quando não há mais dados
+// prontos a ler, pelo que nenhum registo fica à espera dos seguintes. Há no
+// máximo dois lotes por thread em curso, e a memória não depende do número de
+// registos. Com ordered a saída segue a ordem da entrada
+void streamScores(const MetaClass &model, double a, ThreadPool *pool, size_t batchSize, bool ordered) {
+    LineChannel input(0, 1);
+    LineChannel output(0, 1);
+    RecordReader reader(input);
+
+    mutex outputMutex;
+    condition_variable slotFree;
+    size_t inFlight = 0;
+    const size_t maxInFlight = pool ? 2 * pool->size() : 1;
+    map<size_t, string> finished;       // lotes à espera dos anteriores (ordered)
+    size_t nextOutput = 0;
+
+    auto score = [&](const StreamBatch &batch) {
+        ostringstream text;
+        text << setprecision(17);
+        for(size_t i = 0; i < batch.ids.size(); i++)
+            text << batch.ids[i] << "\t" << model.computeNRC(batch.sequences[i], a) << "\n";
+
+        // Um lote só liberta o seu lugar depois de escrito: com ordered, os lotes
+        // à espera de um anterior mais lento continuam a contar para maxInFlight
+        lock_guard<mutex> lock(outputMutex);
+        if(!ordered) {
+            output.write(text.str());
+            inFlight--;
+        } else {
+            finished[batch.number] = text.str();
+            for(auto first = finished.begin(); first != finished.end() && first->first == nextOutput;
+                first = finished.erase(first), nextOutput++) {
+                output.write(first->second);
+                inFlight--;
+            }
+        }
+        output.flush();
+        slotFree.notify_one();
+    };
+
+    auto batch = make_shared<StreamBatch>();
+    batch->number = 0;
+    auto dispatch = [&]() {
+        if(batch->ids.empty())
+            return;
+        {
+            unique_lock<mutex> lock(outputMutex);
+            slotFree.wait(lock, [&] { return inFlight < maxInFlight; });
+            inFlight++;
+        }
+        if(pool)
+            pool->submit([batch, &score] { score(*batch); });
+        else
+            score(*batch);
+        size_t number = batch->number + 1;
+        batch = make_shared<StreamBatch>();
+        batch->number = number;
+    };
+
+    string id, sequence;
+    while(reader.next(id, sequence)) {
+        batch->ids.push_back(move(id));
+        batch->sequences.push_back(move(sequence));
+        if(batch->ids.size() >= batchSize || !reader.pending())
+            dispatch();
+    }
+    dispatch();
+    if(pool)
+        pool->wait();
+}
+
+// Escreve a tabela k x alpha x sequência do varrimento, uma linha por combinação;
+// com mixed, os NRC da mistura seguem-se aos dos modelos, com k = mix
+void writeSweep(ostream &out, const vector<MetaClass> &models, const vector<double> &alphas,
+                const deque<SequenceResult> &results, bool mixed) {
+    out << "k,alpha,id,nrc\n";
+    out << setprecision(17);
+    for(size_t m = 0; m < models.size() + (mixed ? 1 : 0); m++) {
+        string order = m < models.size() ? to_string(models[m].k) : "mix";
+        for(size_t j = 0; j < alphas.size(); j++) {
+            for(const SequenceResult &res : results) {
+                out << order << "," << alphas[j] << "," << csvQuote(res.id) << ","
+                    << res.nrcs[m * alphas.size() + j] << "\n";
+            }
+        }
+    }
 }
 
 int main(int argc, char* argv[]){
-    if(argc < 9) {
+    StatsReporter reporter;
+    if(argc < 7) {
         printUsage(argv[0]);
         return 1;
     }
     
     string db_filename;
-    string model_filename;
-    double a;
-    int top;
+    vector<string> model_filenames;
+    vector<double> alphas;
+    int top = -1;
+    int order = -1;
+    int threads = 1;
+    double gamma = -1.0;
+    size_t batchSize = 16;
+    bool ordered = false;
+    string output_filename;
     
     // Processa os argumentos da linha de comando
     for(int i = 1; i < argc; i++){
@@ -45,11 +171,27 @@ int main(int argc, char* argv[]){
         if(arg == "-db" && i+1 < argc) {
             db_filename = argv[++i];
         } else if(arg == "-m" && i+1 < argc) {
-            model_filename = argv[++i];
+            model_filenames = splitList(argv[++i]);
         } else if(arg == "-a" && i+1 < argc) {
-            a = atof(argv[++i]);
+            alphas.clear();
+            for(const string &value : splitList(argv[++i]))
+                alphas.push_back(atof(value.c_str()));
+        } else if(arg == "-k" && i+1 < argc) {
+            order = atoi(argv[++i]);
+        } else if(arg == "-o" && i+1 < argc) {
+            output_filename = argv[++i];
         } else if(arg == "-t" && i+1 < argc) {
             top = atoi(argv[++i]);
+        } else if(arg == "-j" && i+1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if(arg == "-mix" && i+1 < argc) {
+            gamma = atof(argv[++i]);
+        } else if(arg == "-batch" && i+1 < argc) {
+            batchSize = max(1l, atol(argv[++i]));
+        } else if(arg == "-ordered") {
+            ordered = true;
+        } else if(arg == "--stats" || arg == "-stats") {
+            statsEnable();
         } else {
             cerr << "Argumento inválido: " << arg << endl;
             printUsage(argv[0]);
@@ -57,62 +199,243 @@ int main(int argc, char* argv[]){
         }
     }
     
-    // Carrega o modelo usando a classe MetaClass
-    MetaClass model;
-    if(!model.loadModel(model_filename)){
-        cerr << "Erro a carregar o modelo" << endl;
+    if(threads < 0) {
+        cerr << "O número de threads deve ser positivo (0 usa todos os núcleos)." << endl;
         return 1;
     }
-    
-    // Abre o ficheiro da base de dados (db.txt) e processa cada sequência
-    ifstream dbFile(db_filename);
-    if(!dbFile) {
-        cerr << "Erro ao abrir o ficheiro da base de dados: " << db_filename << endl;
+    if(model_filenames.empty() || alphas.empty()) {
+        cerr << "Indique pelo menos um modelo (-m) e um alpha (-a)." << endl;
+        printUsage(argv[0]);
         return 1;
     }
-    
-    vector<SequenceResult> results;
-    string line;
-    string current_id;
-    string current_seq;
-    
-    while(getline(dbFile, line)) {
-        trim(line);
-        if(line.empty()) continue;
-        if(line[0] == '@'){
-            if(!current_id.empty() && !current_seq.empty()){
-                SequenceResult res;
-                res.id = current_id;
-                res.seq = current_seq;
-                res.nrc = model.computeNRC(current_seq, a);
-                results.push_back(res);
+
+    // Ordem a usar de cada ficheiro: -k escolhe uma; sem -k, um conjunto de modelos
+    // (models_generator -k a-b) contribui com todas as suas ordens
+    vector<pair<string, int>> modelSources;
+    for(const string &filename : model_filenames) {
+        if(order > 0) {
+            modelSources.push_back({filename, order});
+            continue;
+        }
+        vector<int> orders = MetaClass::modelOrders(filename);
+        if(orders.empty()) {
+            cerr << "Erro a carregar o modelo" << endl;
+            return 1;
+        }
+        for(int k : orders)
+            modelSources.push_back({filename, orders.size() > 1 ? k : -1});
+    }
+
+    // Com -db - os registos chegam por stdin e são pontuados à medida que chegam
+    bool streaming = db_filename == "-";
+    if(streaming && (modelSources.size() > 1 || alphas.size() > 1 || gamma >= 0.0)) {
+        cerr << "O modo contínuo (-db -) usa um único modelo e um único alpha." << endl;
+        return 1;
+    }
+
+    // Com -mix os modelos são combinados numa única passagem por sequência (e alpha)
+    bool mix = gamma >= 0.0;
+    if(mix && (gamma <= 0.0 || gamma > 1.0)) {
+        cerr << "O fator de esquecimento da mistura (-mix) deve estar em ]0, 1]." << endl;
+        return 1;
+    }
+    if(mix && modelSources.size() < 2) {
+        cerr << "A mistura (-mix) precisa de pelo menos dois modelos: vários ficheiros em -m ou um conjunto sem -k." << endl;
+        return 1;
+    }
+    if(mix && top >= 0 && alphas.size() > 1) {
+        cerr << "O ranking da mistura (-t) usa um único alpha." << endl;
+        return 1;
+    }
+
+    // Com vários modelos ou vários alphas cada sequência é percorrida uma única vez
+    // por modelo e avaliada para todos os alphas; o resultado é a tabela completa.
+    // Com -mix e -t o resultado é o ranking pelo NRC da mistura
+    bool sweep = (modelSources.size() > 1 || alphas.size() > 1) && !(mix && top >= 0);
+    if(!sweep && !streaming && top < 0) {
+        cerr << "Indique o número de sequências a mostrar (-t)." << endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    double a = alphas[0];
+
+    // Carrega os modelos usando a classe MetaClass
+    ScopedTimer loadTimer("carregar modelo");
+    vector<MetaClass> models(modelSources.size());
+    for(size_t m = 0; m < models.size(); m++) {
+        MetaClass &model = models[m];
+        if(!model.loadModel(modelSources[m].first, modelSources[m].second)){
+            cerr << "Erro a carregar o modelo" << endl;
+            return 1;
+        }
+        // Um modelo compilado só guarda os custos para o alpha com que foi gerado
+        for(double alpha : alphas) {
+            if(model.isCompiled() && !model.hasCounts() && model.compiledAlpha() != alpha) {
+                cerr << "O modelo compilado " << modelSources[m].first << " foi gerado com alpha = " << model.compiledAlpha()
+                     << "; use esse valor em -a ou compile o modelo para " << alpha << endl;
+                return 1;
             }
-            current_id = line.substr(1); // remove o '@'
-            current_seq.clear();
-        } else {
-            current_seq += line;
         }
     }
-    // Guarda a última sequência
-    if(!current_id.empty() && !current_seq.empty()){
-        SequenceResult res;
-        res.id = current_id;
-        res.seq = current_seq;
-        res.nrc = model.computeNRC(current_seq, a);
-        results.push_back(res);
+    const MetaClass &model = models[0];
+    vector<const MetaClass *> mixture;
+    if(mix) {
+        for(const MetaClass &m : models)
+            mixture.push_back(&m);
+    }
+    loadTimer.stop();
+
+    if(streaming) {
+        unique_ptr<ThreadPool> pool;
+        if(threads != 1)
+            pool = make_unique<ThreadPool>(threads);
+        ScopedTimer scoreTimer("pontuar");
+        try {
+            streamScores(model, a, pool.get(), batchSize, ordered);
+        } catch(const exception &e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        return 0;
     }
-    dbFile.close();
     
-    // Ordena os resultados por NRC (ordem crescente: menor NRC indica maior similaridade)
-    sort(results.begin(), results.end(), [](const SequenceResult &a, const SequenceResult &b){
-        return a.nrc < b.nrc;
-    });
+    // Abre a base de dados (texto ou empacotada por db_pack) e processa cada sequência
+    ScopedTimer openTimer("abrir base de dados");
+    SequenceDb db;
+    if(!db.open(db_filename))
+        return 1;
+    openTimer.stop();
     
-    cout << "Top " << top << " sequências por NRC (menor é melhor):" << endl;
-    int printed = min(static_cast<int>(results.size()), top);
-    for (int i = 0; i < printed; i++){
-        cout << i+1 << ". " << results[i].id << " - NRC: " << results[i].nrc << endl;
+    unique_ptr<ThreadPool> pool;
+    if(threads != 1)
+        pool = make_unique<ThreadPool>(threads);
+
+    if(!sweep && mix) {
+        // A mistura não tem um limite inferior de custo: todas as sequências são
+        // pontuadas por inteiro e o NRC de cada ordem é guardado para o relatório
+        ScopedTimer scoreTimer("pontuar");
+        TopResults best(top);
+        vector<vector<double>> orderNrcs(db.size());
+        auto rank = [&db, &mixture, &best, &orderNrcs, a, gamma](size_t record) {
+            MixtureNRC result = MetaClass::computeMixtureNRC(mixture, db.sequence(record), a, gamma);
+            orderNrcs[record] = move(result.nrcs);
+            best.offer(result.mixed, record);
+        };
+        for(size_t record = 0; record < db.size(); record++) {
+            if(pool)
+                pool->submit([&rank, record] { rank(record); });
+            else
+                rank(record);
+        }
+        if(pool)
+            pool->wait();
+        scoreTimer.stop();
+
+        ScopedTimer outputTimer("escrever resultados");
+        vector<TopEntry> ranking = best.sorted();
+        cout << "Top " << top << " sequências por NRC da mistura (menor é melhor):" << endl;
+        for(size_t i = 0; i < ranking.size(); i++){
+            cout << i+1 << ". " << db.id(ranking[i].record) << " - NRC: " << ranking[i].nrc << " (";
+            for(size_t m = 0; m < models.size(); m++)
+                cout << (m ? ", " : "") << "k" << models[m].k << ": " << orderNrcs[ranking[i].record][m];
+            cout << ")" << endl;
+        }
+        return 0;
+    }
+
+    if(!sweep) {
+        // Só os top melhores são guardados; uma sequência cujo custo parcial já a
+        // exclui do top (com o menor custo possível nas posições em falta) deixa
+        // de ser pontuada. O ranking é igual ao da ordenação de todos os resultados
+        ScopedTimer scoreTimer("pontuar");
+        TopResults best(top);
+        // O limite inferior exato percorre o modelo inteiro (e lê todo o ficheiro
+        // mapeado), pelo que só é calculado quando há bastante mais posições a pontuar
+        // do que entradas na tabela; senão usa-se 0, que continua a ser um limite
+        // válido (as sequências são abandonadas mais tarde). Com no máximo top
+        // sequências nenhuma é abandonada
+        size_t dbSymbols = 0;
+        for(size_t record = 0; record < db.size(); record++)
+            dbSymbols += db.length(record);
+        const bool useBound = db.size() > static_cast<size_t>(top) && model.minSymbolCostPays(dbSymbols);
+        const double minCost = useBound ? model.minSymbolCost(a) : 0.0;
+        auto rank = [&db, &model, &best, a, minCost](size_t record) {
+            best.offer(model.computeNRCBounded(db.sequence(record), a, best.limit(), minCost), record);
+        };
+        for(size_t record = 0; record < db.size(); record++) {
+            if(pool)
+                pool->submit([&rank, record] { rank(record); });
+            else
+                rank(record);
+        }
+        if(pool)
+            pool->wait();
+        scoreTimer.stop();
+
+        ScopedTimer outputTimer("escrever resultados");
+        vector<TopEntry> ranking = best.sorted();
+        cout << "Top " << top << " sequências por NRC (menor é melhor):" << endl;
+        for(size_t i = 0; i < ranking.size(); i++){
+            cout << i+1 << ". " << db.id(ranking[i].record) << " - NRC: " << ranking[i].nrc << endl;
+        }
+        return 0;
+    }
+
+    // Os resultados ficam pela ordem da base de dados; um deque mantém os
+    // endereços estáveis enquanto os workers escrevem o NRC de registos anteriores
+    ScopedTimer scoreTimer("pontuar");
+    deque<SequenceResult> results;
+
+    // A sequência é obtida (e, numa base empacotada, descodificada) no próprio worker
+    auto score = [&db, &models, &alphas, &mixture, gamma](size_t record, SequenceResult *res) {
+        string seq = db.sequence(record);
+        if(!mixture.empty()) {
+            const size_t numAlphas = alphas.size();
+            res->nrcs.resize((models.size() + 1) * numAlphas);
+            for(size_t j = 0; j < numAlphas; j++) {
+                MixtureNRC result = MetaClass::computeMixtureNRC(mixture, seq, alphas[j], gamma);
+                for(size_t m = 0; m < models.size(); m++)
+                    res->nrcs[m * numAlphas + j] = result.nrcs[m];
+                res->nrcs[models.size() * numAlphas + j] = result.mixed;
+            }
+            return;
+        }
+        res->nrcs.reserve(models.size() * alphas.size());
+        for(const MetaClass &m : models) {
+            vector<double> nrcs = m.computeNRCs(seq, alphas);
+            res->nrcs.insert(res->nrcs.end(), nrcs.begin(), nrcs.end());
+        }
+    };
+
+    for(size_t record = 0; record < db.size(); record++) {
+        results.push_back({db.id(record), {}});
+        SequenceResult *res = &results.back();
+        if(pool) {
+            pool->submit([&score, record, res] {
+                score(record, res);
+            });
+        } else {
+            score(record, res);
+        }
+    }
+    if(pool)
+        pool->wait();
+    scoreTimer.stop();
+
+    ScopedTimer outputTimer("escrever resultados");
+    if(output_filename.empty() || output_filename == "-") {
+        writeSweep(cout, models, alphas, results, mix);
+    } else {
+        ofstream out(output_filename);
+        if(!out) {
+            cerr << "Erro ao criar o ficheiro de saída: " << output_filename << endl;
+            return 1;
+        }
+        writeSweep(out, models, alphas, results, mix);
+        if(!out) {
+            cerr << "Erro ao escrever o ficheiro de saída: " << output_filename << endl;
+            return 1;
+        }
     }
-    
     return 0;
 }
\ No newline at end of file
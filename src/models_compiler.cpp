@@ -0,0 +1,79 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <filesystem>
+#include "MetaClass.hpp"
+
+using namespace std;
+namespace fs = filesystem;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -m <model_file> -a <smoothing_parameter> [-k <k>] [-o <output_file>]" << endl;
+    cout << "Example: " << progName << " -m models/k13.bin -a 0.01" << endl;
+    cout << "Bundle:  " << progName << " -m models/k8-16.bin -k 13 -a 0.01" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string modelFilename;
+    string outputFilename;
+    double a = -1.0;
+    // Ordem a compilar de um conjunto de modelos; -1 num modelo simples
+    int order = -1;
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-m" && i + 1 < argc) {
+            modelFilename = argv[++i];
+        } else if (arg == "-a" && i + 1 < argc) {
+            a = atof(argv[++i]);
+        } else if (arg == "-k" && i + 1 < argc) {
+            order = atoi(argv[++i]);
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (a <= 0) {
+        cerr << "O valor de alpha deve ser positivo." << endl;
+        return 1;
+    }
+
+    if (order != -1 && (order < 1 || order > 31)) {
+        cerr << "O valor de k deve ser um inteiro entre 1 e 31." << endl;
+        return 1;
+    }
+
+    MetaClass model;
+    if (!model.loadModel(modelFilename, order)) {
+        cerr << "Erro a carregar o modelo" << endl;
+        return 1;
+    }
+    if (model.isCompiled()) {
+        cerr << "O modelo " << modelFilename << " já está compilado" << endl;
+        return 1;
+    }
+
+    // Calcula os custos -log2(P(s|c)) de todos os pares (contexto, símbolo)
+    if (!model.compile(a))
+        return 1;
+
+    if (outputFilename.empty()) {
+        fs::create_directories("models");
+        outputFilename = "models/k" + to_string(model.k) + "_a" + to_string(a) + ".bin";
+    }
+    if (!model.saveCompiled(outputFilename))
+        return 1;
+
+    cout << "Modelo compilado e guardado em " << outputFilename << endl;
+    return 0;
+}
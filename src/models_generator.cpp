@@ -1,113 +1,93 @@
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <vector>
 #include <string>
-#include <cctype>
 #include <stdexcept>
 #include <filesystem>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include "ModelFile.hpp"
+#include "ModelCounts.hpp"
+#include "SparseTable.hpp"
+#include "ContextCounter.hpp"
+#include "Nucleotide.hpp"
+#include "Stats.hpp"
 
 using namespace std;
 namespace fs = filesystem;
 
 void printUsage(const string& progName) {
-    cout << "Usage: " << progName << " -meta <meta_file> -k <context_size>" << endl;
+    cout << "Usage: " << progName << " -meta <meta_file> -k <context_size>|<k_min>-<k_max> [-sparse | -dense] [-w <8|16|32>] [-j <threads>] [-ir] [-append <model>] [--stats]" << endl;
     cout << "Example: " << progName << "-meta txt_files/meta.txt -k 13" << endl;
+    cout << "Bundle:  " << progName << "-meta txt_files/meta.txt -k 8-16" << endl;
+    cout << "Append:  " << progName << "-meta txt_files/new.txt -append models/k13.bin" << endl;
 }
 
-// Converte um caractere (A, C, G, T) para índice (0 a 3)
-int charToIndex(char c) {
-    c = toupper(c);
-    switch(c) {
-        case 'A': return 0;
-        case 'C': return 1;
-        case 'G': return 2;
-        case 'T': return 3;
-        default:   return -1;
-    }
-}
-
-// Calcula 4^k
-unsigned long power4(int k) {
-    unsigned long res = 1;
-    for (int i = 0; i < k; i++)
-        res *= 4;
-    return res;
-}
-
-// Lê o conteúdo completo de um arquivo
-string readFile(const string& filename) {
-    ifstream file(filename);
-    if (!file)
-        throw runtime_error("Erro ao abrir o arquivo " + filename);
-    stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
-}
+// Tamanho das leituras do ficheiro e dos blocos de sequência entregues ao contador
+static const size_t READ_SIZE = 1 << 20;
+static const size_t BLOCK_SYMBOLS = 1 << 24;
 
-// Extrai da string apenas os caracteres A, C, G, T (em maiúsculo)
-string extractSequence(const string& content) {
-    string sequence;
-    for (char c : content) {
-        char uc = toupper(c);
-        if (uc == 'A' || uc == 'C' || uc == 'G' || uc == 'T')
-            sequence.push_back(uc);
+// Lê o arquivo ("-" lê de stdin) por partes de tamanho fixo e extrai apenas os
+// caracteres A, C, G, T (maiúsculos ou minúsculos), entregando a consume os seus
+// códigos 0-3 em blocos de BLOCK_SYMBOLS símbolos; nunca guarda o arquivo inteiro em memória
+void streamSequence(const string& filename, const function<void(const vector<uint8_t>&)>& consume) {
+    ifstream file;
+    if (filename != "-") {
+        file.open(filename, ios::binary);
+        if (!file)
+            throw runtime_error("Erro ao abrir o arquivo " + filename);
     }
-    return sequence;
-}
+    istream& in = filename == "-" ? cin : file;
 
-// Calcula as contagens dos contextos utilizando a técnica de janela deslizante
-vector<int> countContexts(const string& sequence, int k) {
-    if (sequence.size() < static_cast<size_t>(k + 1))
-        throw runtime_error("Sequência demasiado curta para o valor de k fornecido.");
-
-    unsigned long numContexts = power4(k);
-    // Vetor de contagens: cada contexto (numContexts) com 4 possíveis símbolos seguintes
-    vector<int> counts(numContexts * 4, 0);
-
-    // Calcula o índice do primeiro contexto (janela de tamanho k)
-    unsigned long context = 0;
-    for (int j = 0; j < k; j++) {
-        int idx = charToIndex(sequence[j]);
-        if (idx < 0)
-            throw runtime_error("Caractere inválido encontrado na sequência.");
-        context = context * 4 + idx;
-    }
-    // Conta o símbolo que segue o primeiro contexto
-    int sym = charToIndex(sequence[k]);
-    if (sym >= 0)
-        counts[context * 4 + sym]++;
-
-    // Pre-calcula 4^(k-1) para atualizar a janela deslizante
-    unsigned long highest = power4(k - 1);
-
-    // Atualiza os contextos de forma deslizante e incrementa as contagens
-    for (size_t i = 1; i <= sequence.size() - k - 1; i++) {
-        int new_digit = charToIndex(sequence[i + k - 1]);
-        context = (context % highest) * 4 + new_digit;
-        int next_sym = charToIndex(sequence[i + k]);
-        if (next_sym >= 0)
-            counts[context * 4 + next_sym]++;
+    vector<char> buffer(READ_SIZE);
+    vector<uint8_t> block;
+    block.reserve(BLOCK_SYMBOLS + READ_SIZE);
+    while (in) {
+        ScopedTimer timer("ler referência");
+        in.read(buffer.data(), buffer.size());
+        size_t read = in.gcount();
+        statsAdd(STAT_BYTES_READ, read);
+        // Os códigos são escritos no fim do bloco e os inválidos retirados no mesmo sítio
+        size_t used = block.size();
+        block.resize(used + read);
+        if (encodeNucleotides(buffer.data(), read, block.data() + used) > 0)
+            block.erase(remove(block.begin() + used, block.end(), NUCLEOTIDE_INVALID), block.end());
+        timer.stop();
+        if (block.size() >= BLOCK_SYMBOLS) {
+            consume(block);
+            block.clear();
+        }
     }
-
-    return counts;
+    if (in.bad())
+        throw runtime_error("Erro a ler o arquivo " + filename);
+    if (!block.empty())
+        consume(block);
 }
 
-// Grava o modelo (valor de k e as contagens) em um arquivo binário
-void writeModel(const string& modelFilename, int k, const vector<int>& counts) {
-    // Cria o diretório "models" de forma portável
-    fs::create_directories("models");
-
-    ofstream outFile(modelFilename, ios::binary);
-    if (!outFile)
-        throw runtime_error("Erro ao abrir " + modelFilename + " para escrita");
+// Tamanho do arquivo, que limita o comprimento da sequência; 0 se não for conhecido (stdin)
+size_t sizeHint(const string& filename) {
+    error_code error;
+    if (filename == "-" || !fs::is_regular_file(filename, error))
+        return 0;
+    uintmax_t size = fs::file_size(filename, error);
+    return error ? 0 : size;
+}
 
-    outFile.write(reinterpret_cast<const char*>(&k), sizeof(int));
-    outFile.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(int));
-    outFile.close();
+// Lê "13" ou um intervalo "8-16"
+bool parseOrders(const string& value, int& kMin, int& kMax) {
+    try {
+        size_t dash = value.find('-', 1);
+        kMin = stoi(value.substr(0, dash));
+        kMax = dash == string::npos ? kMin : stoi(value.substr(dash + 1));
+    } catch (const exception& e) {
+        return false;
+    }
+    return true;
 }
 
 int main(int argc, char* argv[]) {
+    StatsReporter reporter;
     if (argc < 5) {
         printUsage(argv[0]);
         return 1;
@@ -115,6 +95,14 @@ int main(int argc, char* argv[]) {
 
     string metaFilename;
     int k = 0;
+    int kMin = 0;
+    // -1 escolhe automaticamente, 0 força a tabela densa, 1 a esparsa
+    int sparseMode = -1;
+    // 0: 32 bits, ou com -append a largura do modelo existente
+    int countBits = 0;
+    int threads = 1;
+    bool invertedRepeats = false;
+    string appendFilename;
 
     // Processa os argumentos da linha de comando
     for (int i = 1; i < argc; i++) {
@@ -122,12 +110,24 @@ int main(int argc, char* argv[]) {
         if (arg == "-meta" && i + 1 < argc) {
             metaFilename = argv[++i];
         } else if (arg == "-k" && i + 1 < argc) {
-            try {
-                k = stoi(argv[++i]);
-            } catch (const invalid_argument& e) {
+            if (!parseOrders(argv[++i], kMin, k)) {
                 cerr << "Valor inválido para k: " << argv[i] << endl;
                 return 1;
             }
+        } else if (arg == "-sparse") {
+            sparseMode = 1;
+        } else if (arg == "-dense") {
+            sparseMode = 0;
+        } else if (arg == "-w" && i + 1 < argc) {
+            countBits = atoi(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "-ir") {
+            invertedRepeats = true;
+        } else if (arg == "-append" && i + 1 < argc) {
+            appendFilename = argv[++i];
+        } else if (arg == "--stats") {
+            statsEnable();
         } else {
             cerr << "Argumento inválido: " << arg << endl;
             printUsage(argv[0]);
@@ -135,8 +135,43 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    if (k <= 0) {
-        cerr << "O valor de k deve ser um inteiro positivo." << endl;
+    // Com -append as ordens vêm do modelo existente se -k for omitido, e têm de
+    // coincidir com as dele se for indicado
+    MappedCounts existing;
+    if (!appendFilename.empty()) {
+        try {
+            existing.open(appendFilename);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        if (k == 0) {
+            k = existing.orders.front().k;
+            kMin = existing.orders.back().k;
+        }
+        bool sameOrders = existing.bundle == (kMin != k) && existing.orders.size() == static_cast<size_t>(k - kMin + 1);
+        for (size_t i = 0; sameOrders && i < existing.orders.size(); i++)
+            sameOrders = existing.orders[i].k == k - static_cast<int>(i);
+        if (!sameOrders) {
+            cerr << "As ordens de -k não coincidem com as do modelo " << appendFilename << "." << endl;
+            return 1;
+        }
+    }
+
+    if (kMin <= 0 || k > 31 || kMin > k) {
+        cerr << "O valor de k deve ser um inteiro entre 1 e 31 (ou um intervalo crescente nesses limites)." << endl;
+        return 1;
+    }
+    if (countBits != 0 && countBits != 8 && countBits != 16 && countBits != 32) {
+        cerr << "A largura das contagens deve ser 8, 16 ou 32 bits." << endl;
+        return 1;
+    }
+    if (sparseMode == 1 && countBits != 0 && countBits != 32) {
+        cerr << "-w " << countBits << " só se aplica a modelos densos; os esparsos têm contagens de 32 bits." << endl;
+        return 1;
+    }
+    if (threads < 0) {
+        cerr << "O número de threads deve ser positivo (0 usa todos os núcleos)." << endl;
         return 1;
     }
     if (metaFilename.empty()) {
@@ -145,18 +180,101 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        // Lê o conteúdo do arquivo e extrai a sequência
-        string content = readFile(metaFilename);
-        string sequence = extractSequence(content);
+        // Cria o diretório "models" de forma portável
+        fs::create_directories("models");
 
-        // Calcula as contagens dos contextos
-        vector<int> counts = countContexts(sequence, k);
+        // O comprimento só é conhecido no fim da leitura: a representação da ordem mais
+        // alta é escolhida pelo tamanho do arquivo (ou como para uma sequência longa, se
+        // for lido de stdin) e convertida no fim se o comprimento real pedir a outra
+        auto sparseFor = [&](int order, size_t length) {
+            // Com -ir são contadas as posições das duas cadeias
+            size_t positions = invertedRepeats ? 2 * length : length;
+            bool sparse = sparseMode < 0 ? preferSparse(positions, order) : sparseMode == 1;
+            if (!sparse && order >= 16)
+                throw runtime_error("A tabela densa para k = " + to_string(order) + " não cabe em memória; use -sparse.");
+            return sparse;
+        };
 
-        // Define o nome do arquivo do modelo e grava o modelo
-        string modelFilename = "models/k" + to_string(k) + ".bin";
-        writeModel(modelFilename, k, counts);
+        // Grava as contagens da ordem na posição index do modelo ou conjunto. Com -append
+        // somam-se primeiro às da mesma ordem do modelo existente, na representação e
+        // largura dele (salvo -sparse, -dense ou -w): a sequência nova é contada à parte,
+        // pelo que não surgem contextos que juntem o fim dos dados antigos ao início dos
+        // novos, e o custo é o da contagem nova mais uma passagem pela tabela
+        auto output = [&](const ModelSink& write, size_t index, const ContextCounts& counts) {
+            if (appendFilename.empty()) {
+                ScopedTimer timer("gravar modelo");
+                writeCounts(write, counts, countBits == 0 ? 32 : countBits);
+                return;
+            }
+            const CountsView& old = existing.orders[index];
+            bool sparse = sparseMode < 0 ? old.sparse : sparseMode == 1;
+            if (!sparse && counts.k >= 16)
+                throw runtime_error("A tabela densa para k = " + to_string(counts.k) + " não cabe em memória; use -sparse.");
+            ScopedTimer sumTimer("somar contagens");
+            ContextCounts merged = sumCounts({old, viewCounts(counts)}, sparse, threads);
+            sumTimer.stop();
+            ScopedTimer timer("gravar modelo");
+            writeCounts(write, merged, countBits != 0 ? countBits : sparse || old.sparse ? 32 : old.width * 8);
+        };
 
-        cout << "Modelo gerado e guardado em " << modelFilename << endl;
+        // Com -ir cada posição conta também o contexto da cadeia complementar
+        // invertida (o dobro das contagens); os modelos ficam em k*_ir.bin
+        ContextStream stream(k, sparseFor(k, sizeHint(metaFilename)), threads, invertedRepeats);
+        const string suffix = invertedRepeats ? "_ir" : "";
+        streamSequence(metaFilename, [&stream](const vector<uint8_t>& block) {
+            ScopedTimer timer("contar contextos");
+            stream.add(block);
+        });
+        vector<RunPrefix> prefixes;
+        ScopedTimer finishTimer("contar contextos");
+        ContextCounts counts = stream.finish(prefixes);
+        finishTimer.stop();
+        const size_t length = stream.length();
+        if (sparseFor(k, length) != counts.sparse) {
+            ScopedTimer timer("converter representação");
+            counts = convertCounts(counts, !counts.sparse);
+        }
+
+        // Com -append o modelo é gravado num ficheiro temporário que depois substitui o
+        // existente, ainda mapeado durante a soma
+        string outputFilename = appendFilename.empty()
+            ? "models/k" + (kMin == k ? "" : to_string(kMin) + "-") + to_string(k) + suffix + ".bin"
+            : appendFilename + ".tmp";
+        if (kMin == k) {
+            ModelSink write = [&outputFilename](const ModelHeader& header, const void* payload) {
+                writeModelFile(outputFilename, header, payload);
+            };
+            output(write, 0, counts);
+        } else {
+            // Conjunto de modelos: só a ordem mais alta é contada sobre a sequência; as
+            // restantes derivam dela, da mais alta para a mais baixa, e são gravadas à
+            // medida que são obtidas, pelo que só duas ordens estão em memória de cada vez
+            BundleWriter bundle(outputFilename, k - kMin + 1);
+            ModelSink write = [&bundle](const ModelHeader& header, const void* payload) {
+                bundle.add(header, payload);
+            };
+
+            for (int order = k;; order--) {
+                output(write, k - order, counts);
+                if (order == kMin)
+                    break;
+                ScopedTimer deriveTimer("derivar ordem inferior");
+                counts = lowerOrder(counts, prefixes, sparseFor(order - 1, length));
+            }
+            ScopedTimer closeTimer("gravar modelo");
+            bundle.close();
+        }
+
+        if (!appendFilename.empty()) {
+            fs::rename(outputFilename, appendFilename);
+            cout << "Contagens de " << metaFilename << " (" << length << " símbolos) somadas ao modelo " << appendFilename << endl;
+        } else if (kMin != k) {
+            cout << "Conjunto de modelos (k = " << kMin << " a " << k << ") gerado e guardado em " << outputFilename << endl;
+        } else if (counts.sparse) {
+            cout << "Modelo esparso (" << counts.table.size() << " contextos) gerado e guardado em " << outputFilename << endl;
+        } else {
+            cout << "Modelo gerado e guardado em " << outputFilename << endl;
+        }
     } catch (const exception& e) {
         cerr << e.what() << endl;
         return 1;
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include <stdexcept>
+#include <filesystem>
+#include "ContextCounter.hpp"
+#include "ModelCounts.hpp"
+#include "ModelFile.hpp"
+#include "Stats.hpp"
+
+using namespace std;
+namespace fs = filesystem;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -m <model_file> -m <model_file> [-m ...] -o <output_file> [-sparse | -dense] [-w <8|16|32>] [-j <threads>] [--stats]" << endl;
+    cout << "Example: " << progName << " -m models/k13_a.bin -m models/k13_b.bin -o models/k13.bin" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    StatsReporter reporter;
+    if (argc < 7) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    vector<string> modelFilenames;
+    string outputFilename;
+    // -1 segue os modelos de entrada, 0 força a tabela densa, 1 a esparsa
+    int sparseMode = -1;
+    int countBits = 32;
+    int threads = 0;
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-m" && i + 1 < argc) {
+            modelFilenames.push_back(argv[++i]);
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else if (arg == "-sparse") {
+            sparseMode = 1;
+        } else if (arg == "-dense") {
+            sparseMode = 0;
+        } else if (arg == "-w" && i + 1 < argc) {
+            countBits = atoi(argv[++i]);
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (arg == "--stats") {
+            statsEnable();
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (modelFilenames.size() < 2) {
+        cerr << "Indique pelo menos dois modelos com -m." << endl;
+        return 1;
+    }
+    if (outputFilename.empty()) {
+        cerr << "Nome do ficheiro de saída não fornecido." << endl;
+        return 1;
+    }
+    if (countBits != 8 && countBits != 16 && countBits != 32) {
+        cerr << "A largura das contagens deve ser 8, 16 ou 32 bits." << endl;
+        return 1;
+    }
+    if (sparseMode == 1 && countBits != 32) {
+        cerr << "-w " << countBits << " só se aplica a modelos densos; os esparsos têm contagens de 32 bits." << endl;
+        return 1;
+    }
+    if (threads < 0) {
+        cerr << "O número de threads deve ser positivo (0 usa todos os núcleos)." << endl;
+        return 1;
+    }
+
+    try {
+        // Os modelos são mapeados e somados diretamente das tabelas dos ficheiros,
+        // sem os copiar para memória própria
+        vector<unique_ptr<MappedCounts>> models;
+        ScopedTimer mapTimer("mapear modelos");
+        for (const string& filename : modelFilenames) {
+            models.push_back(make_unique<MappedCounts>());
+            models.back()->open(filename);
+        }
+        mapTimer.stop();
+
+        // Todos têm de ser modelos simples, ou conjuntos com as mesmas ordens pela mesma ordem
+        const MappedCounts& first = *models.front();
+        for (size_t m = 1; m < models.size(); m++) {
+            bool sameOrders = models[m]->bundle == first.bundle && models[m]->orders.size() == first.orders.size();
+            for (size_t i = 0; sameOrders && i < first.orders.size(); i++)
+                sameOrders = models[m]->orders[i].k == first.orders[i].k;
+            if (!sameOrders)
+                throw runtime_error("Os modelos " + modelFilenames[0] + " e " + modelFilenames[m] + " não têm as mesmas ordens k.");
+        }
+
+        // A saída é gravada num ficheiro temporário, para que possa substituir um dos
+        // modelos de entrada (ainda mapeados durante a soma)
+        const string tempFilename = outputFilename + ".tmp";
+        unique_ptr<BundleWriter> bundle;
+        if (first.bundle)
+            bundle = make_unique<BundleWriter>(tempFilename, first.orders.size());
+        ModelSink write = [&](const ModelHeader& header, const void* payload) {
+            if (bundle)
+                bundle->add(header, payload);
+            else
+                writeModelFile(tempFilename, header, payload);
+        };
+
+        // As ordens são somadas uma de cada vez, pelo que só uma soma está em memória
+        for (size_t i = 0; i < first.orders.size(); i++) {
+            const int k = first.orders[i].k;
+            vector<CountsView> inputs;
+            bool anySparse = false;
+            for (const unique_ptr<MappedCounts>& model : models) {
+                inputs.push_back(model->orders[i]);
+                anySparse = anySparse || model->orders[i].sparse;
+            }
+            // Por omissão a soma é esparsa se algum dos modelos o for
+            bool sparse = sparseMode < 0 ? anySparse : sparseMode == 1;
+            if (!sparse && k >= 16)
+                throw runtime_error("A tabela densa para k = " + to_string(k) + " não cabe em memória; use -sparse.");
+
+            ScopedTimer sumTimer("somar contagens");
+            ContextCounts sum = sumCounts(inputs, sparse, threads);
+            sumTimer.stop();
+            ScopedTimer writeTimer("gravar modelo");
+            writeCounts(write, sum, countBits);
+        }
+        if (bundle) {
+            ScopedTimer closeTimer("gravar modelo");
+            bundle->close();
+        }
+        fs::rename(tempFilename, outputFilename);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    cout << modelFilenames.size() << " modelos somados e guardados em " << outputFilename << endl;
+    return 0;
+}
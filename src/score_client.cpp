@@ -0,0 +1,114 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <stdexcept>
+#include <filesystem>
+#include <unistd.h>
+#include "SequenceDb.hpp"
+#include "ScoreProtocol.hpp"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -s <socket_path> -a <alpha> [-t <k_top>] (-db <db_file> | -q <query_file>)" << endl;
+    cout << "       " << progName << " -s <socket_path> (-ping | -shutdown)" << endl;
+    cout << "Example: " << progName << " -s /tmp/nrc.sock -a 0.01 -t 20 -db txt_files/db.txt" << endl;
+}
+
+// Envia o pedido e escreve em stdout as linhas da resposta; lança runtime_error se
+// o servidor devolver um erro
+void request(LineChannel &channel, const string &text) {
+    channel.write(text);
+    channel.flush();
+    string status;
+    if (!channel.readLine(status))
+        throw runtime_error("O servidor fechou a ligação");
+    if (status.compare(0, 3, "OK ") != 0)
+        throw runtime_error("Erro do servidor: " + (status.size() > 4 ? status.substr(4) : status));
+    size_t lines = strtoull(status.c_str() + 3, nullptr, 10);
+    string line;
+    for (size_t i = 0; i < lines && channel.readLine(line); i++)
+        cout << line << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 4) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string socketPath;
+    string dbFilename;
+    string queryFilename;
+    string command;
+    double a = -1.0;
+    long top = -1;
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-s" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "-a" && i + 1 < argc) {
+            a = atof(argv[++i]);
+        } else if (arg == "-t" && i + 1 < argc) {
+            top = atol(argv[++i]);
+        } else if (arg == "-db" && i + 1 < argc) {
+            dbFilename = argv[++i];
+        } else if (arg == "-q" && i + 1 < argc) {
+            queryFilename = argv[++i];
+        } else if (arg == "-ping") {
+            command = "PING";
+        } else if (arg == "-shutdown") {
+            command = "SHUTDOWN";
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (socketPath.empty() || (command.empty() && (a < 0 || dbFilename.empty() == queryFilename.empty()))) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (!dbFilename.empty() && top < 0) {
+        cerr << "Indique o número de sequências a mostrar (-t)." << endl;
+        return 1;
+    }
+
+    try {
+        int fd = connectUnixSocket(socketPath);
+        LineChannel channel(fd, fd);
+        ostringstream text;
+        text << setprecision(17);
+        if (!command.empty()) {
+            text << command << "\n";
+        } else if (!dbFilename.empty()) {
+            // O servidor pode estar noutra diretoria
+            text << "DB " << a << " " << top << " " << fs::absolute(dbFilename).string() << "\n";
+        } else {
+            SequenceDb queries;
+            if (!queries.open(queryFilename))
+                return 1;
+            if (top >= 0)
+                text << "TOP " << a << " " << top << " " << queries.size() << "\n";
+            else
+                text << "SCORE " << a << " " << queries.size() << "\n";
+            for (size_t i = 0; i < queries.size(); i++)
+                text << queries.id(i) << "\t" << queries.sequence(i) << "\n";
+        }
+        request(channel, text.str());
+        if (command != "SHUTDOWN")
+            channel.write("QUIT\n");
+        channel.flush();
+        close(fd);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
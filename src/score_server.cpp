@@ -0,0 +1,320 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <stdexcept>
+#include <csignal>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "MetaClass.hpp"
+#include "ThreadPool.hpp"
+#include "SequenceDb.hpp"
+#include "TopResults.hpp"
+#include "ScoreProtocol.hpp"
+
+using namespace std;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -m <model_file> [-k <k>] [-s <socket_path> | -s -] [-j <threads>]" << endl;
+    cout << "Example: " << progName << " -m models/k13.bin -s /tmp/nrc.sock -j 0" << endl;
+}
+
+// Modelo carregado uma única vez e partilhado por todas as ligações
+struct ScoringService {
+    MetaClass model;
+    unique_ptr<ThreadPool> pool;
+
+    // minSymbolCost percorre o modelo inteiro; é calculado uma vez por alpha
+    mutex minCostMutex;
+    map<double, double> minCosts;
+};
+
+// Um modelo compilado só tem os custos do alpha com que foi gerado
+void checkAlpha(const MetaClass &model, double a) {
+    if (model.isCompiled() && !model.hasCounts() && model.compiledAlpha() != a) {
+        ostringstream message;
+        message << "O modelo compilado foi gerado com alpha = " << model.compiledAlpha();
+        throw runtime_error(message.str());
+    }
+}
+
+// O modelo é percorrido sem o mutex, para que um alpha novo não bloqueie os pedidos
+// dos alphas já calculados; dois pedidos simultâneos do mesmo alpha novo calculam
+// o mesmo valor e o segundo apenas o volta a gravar
+double minCostFor(ScoringService &service, double a) {
+    {
+        lock_guard<mutex> lock(service.minCostMutex);
+        auto found = service.minCosts.find(a);
+        if (found != service.minCosts.end())
+            return found->second;
+    }
+    double cost = service.model.minSymbolCost(a);
+    lock_guard<mutex> lock(service.minCostMutex);
+    service.minCosts[a] = cost;
+    return cost;
+}
+
+// Lê as n linhas "<id>\t<sequência>" de um pedido; sem tabulação a linha é a
+// sequência e o identificador o seu número de ordem
+void readBatch(LineChannel &channel, size_t n, vector<string> &ids, vector<string> &sequences) {
+    string line;
+    for (size_t i = 0; i < n; i++) {
+        if (!channel.readLine(line))
+            throw runtime_error("Pedido incompleto: faltam sequências");
+        size_t tab = line.find('\t');
+        if (tab == string::npos) {
+            ids.push_back(to_string(i + 1));
+            sequences.push_back(line);
+        } else {
+            ids.push_back(line.substr(0, tab));
+            sequences.push_back(line.substr(tab + 1));
+        }
+    }
+}
+
+string formatNrc(double nrc) {
+    ostringstream out;
+    out << setprecision(17) << nrc;
+    return out.str();
+}
+
+// Top-t de count sequências (symbols símbolos no total), com abandono das que já
+// não podem entrar. Como em main, o limite exato só é usado quando o pedido tem
+// posições suficientes para pagar a passagem pelo modelo inteiro; senão usa-se 0
+template <typename Sequence>
+vector<TopEntry> rankSequences(ScoringService &service, double a, size_t top, size_t count, size_t symbols,
+                               Sequence sequence) {
+    TopResults best(top);
+    const bool useBound = count > top && service.model.minSymbolCostPays(symbols);
+    const double minCost = useBound ? minCostFor(service, a) : 0.0;
+    const MetaClass &model = service.model;
+    service.pool->parallelFor(0, count, [&](size_t record) {
+        best.offer(model.computeNRCBounded(sequence(record), a, best.limit(), minCost), record);
+    });
+    return best.sorted();
+}
+
+void writeRanking(LineChannel &channel, const vector<TopEntry> &ranking, const vector<string> &ids) {
+    channel.write("OK " + to_string(ranking.size()) + "\n");
+    for (size_t i = 0; i < ranking.size(); i++)
+        channel.write(to_string(i + 1) + "\t" + ids[i] + "\t" + formatNrc(ranking[i].nrc) + "\n");
+}
+
+void handleScore(ScoringService &service, LineChannel &channel, istringstream &args) {
+    double a;
+    size_t n;
+    if (!(args >> a >> n))
+        throw runtime_error("Uso: SCORE <alpha> <n>");
+    vector<string> ids, sequences;
+    readBatch(channel, n, ids, sequences);
+    checkAlpha(service.model, a);
+
+    vector<double> nrcs(n);
+    const MetaClass &model = service.model;
+    service.pool->parallelFor(0, n, [&](size_t i) {
+        nrcs[i] = model.computeNRC(sequences[i], a);
+    });
+    channel.write("OK " + to_string(n) + "\n");
+    for (size_t i = 0; i < n; i++)
+        channel.write(ids[i] + "\t" + formatNrc(nrcs[i]) + "\n");
+}
+
+void handleTop(ScoringService &service, LineChannel &channel, istringstream &args) {
+    double a;
+    size_t top, n;
+    if (!(args >> a >> top >> n))
+        throw runtime_error("Uso: TOP <alpha> <t> <n>");
+    vector<string> ids, sequences;
+    readBatch(channel, n, ids, sequences);
+    checkAlpha(service.model, a);
+
+    size_t symbols = 0;
+    for (const string &sequence : sequences)
+        symbols += sequence.size();
+    vector<TopEntry> ranking = rankSequences(service, a, top, n, symbols, [&sequences](size_t i) -> const string & {
+        return sequences[i];
+    });
+    vector<string> rankedIds;
+    for (const TopEntry &entry : ranking)
+        rankedIds.push_back(ids[entry.record]);
+    writeRanking(channel, ranking, rankedIds);
+}
+
+void handleDb(ScoringService &service, LineChannel &channel, istringstream &args) {
+    double a;
+    size_t top;
+    string filename;
+    if (!(args >> a >> top) || !getline(args >> ws, filename) || filename.empty())
+        throw runtime_error("Uso: DB <alpha> <t> <ficheiro>");
+    checkAlpha(service.model, a);
+    SequenceDb db;
+    if (!db.open(filename))
+        throw runtime_error("Erro ao abrir a base de dados: " + filename);
+
+    size_t symbols = 0;
+    for (size_t record = 0; record < db.size(); record++)
+        symbols += db.length(record);
+    vector<TopEntry> ranking = rankSequences(service, a, top, db.size(), symbols, [&db](size_t record) {
+        return db.sequence(record);
+    });
+    vector<string> rankedIds;
+    for (const TopEntry &entry : ranking)
+        rankedIds.push_back(db.id(entry.record));
+    writeRanking(channel, ranking, rankedIds);
+}
+
+// Atende os pedidos de uma ligação até QUIT ou ao fim dos dados; devolve true
+// se o cliente pediu SHUTDOWN
+bool serveSession(ScoringService &service, LineChannel &channel) {
+    string line;
+    while (channel.readLine(line)) {
+        istringstream args(line);
+        string command;
+        args >> command;
+        if (command.empty())
+            continue;
+        if (command == "QUIT")
+            return false;
+        if (command == "SHUTDOWN") {
+            channel.write("OK 0\n");
+            channel.flush();
+            return true;
+        }
+        try {
+            if (command == "SCORE")
+                handleScore(service, channel, args);
+            else if (command == "TOP")
+                handleTop(service, channel, args);
+            else if (command == "DB")
+                handleDb(service, channel, args);
+            else if (command == "PING")
+                channel.write("OK 0\n");
+            else
+                throw runtime_error("Comando desconhecido: " + command);
+        } catch (const exception &e) {
+            channel.write(string("ERR ") + e.what() + "\n");
+        }
+        channel.flush();
+    }
+    return false;
+}
+
+// Aceita ligações no socket, cada uma atendida pela sua thread, até SHUTDOWN
+void serveSocket(ScoringService &service, const string &path) {
+    int listenFd = listenUnixSocket(path);
+    cerr << "A servir em " << path << endl;
+
+    mutex sessionsMutex;
+    condition_variable sessionsDone;
+    set<int> sessions;
+    atomic<bool> stopping(false);
+
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (stopping)
+                break;
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            throw runtime_error("Erro ao aceitar ligações em " + path);
+        }
+        {
+            lock_guard<mutex> lock(sessionsMutex);
+            sessions.insert(fd);
+        }
+        thread([&, fd] {
+            bool shutdownRequested = false;
+            try {
+                LineChannel channel(fd, fd);
+                shutdownRequested = serveSession(service, channel);
+            } catch (const exception &e) {
+                cerr << e.what() << endl;
+            }
+            if (shutdownRequested && !stopping.exchange(true))
+                shutdown(listenFd, SHUT_RDWR);
+            lock_guard<mutex> lock(sessionsMutex);
+            close(fd);
+            sessions.erase(fd);
+            sessionsDone.notify_all();
+        }).detach();
+    }
+
+    // Interrompe as ligações ainda abertas e espera que as suas threads terminem
+    unique_lock<mutex> lock(sessionsMutex);
+    for (int fd : sessions)
+        shutdown(fd, SHUT_RDWR);
+    sessionsDone.wait(lock, [&sessions] { return sessions.empty(); });
+    close(listenFd);
+    unlink(path.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    string modelFilename;
+    string socketPath = "-";
+    int order = -1;
+    int threads = 0;
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-m" && i + 1 < argc) {
+            modelFilename = argv[++i];
+        } else if (arg == "-k" && i + 1 < argc) {
+            order = atoi(argv[++i]);
+        } else if (arg == "-s" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "-j" && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (modelFilename.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    if (threads < 0) {
+        cerr << "O número de threads deve ser positivo (0 usa todos os núcleos)." << endl;
+        return 1;
+    }
+
+    ScoringService service;
+    if (!service.model.loadModel(modelFilename, order)) {
+        cerr << "Erro a carregar o modelo" << endl;
+        return 1;
+    }
+    service.pool = make_unique<ThreadPool>(threads);
+
+    // Um cliente que fecha a ligação não deve terminar o servidor
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        if (socketPath == "-") {
+            LineChannel channel(0, 1);
+            serveSession(service, channel);
+        } else {
+            serveSocket(service, socketPath);
+        }
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
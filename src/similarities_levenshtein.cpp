@@ -5,52 +5,22 @@
 #include <cmath>
 #include <cctype>
 #include <algorithm>
+#include <cstdlib>
+#include "Levenshtein.hpp"
+#include "SequenceDb.hpp"
+#include "Stats.hpp"
 
 using namespace std;
 
 void printUsage(const string& progName) {
-  cout << "Usage: " << progName << " -db <db_file> -id1 <sequence1_id> -id2 <sequence2_id>" << endl;
+  cout << "Usage: " << progName << " -db <db_file> -id1 <sequence1_id> -id2 <sequence2_id> [-maxdist <distance>] [--stats]" << endl;
   cout << "Example: " << progName << "-db txt_files/db.txt -id1 'gi|49169782|ref|NC_005831.2| Human Coronavirus NL63, complete genome' -id2 'NC_005831.2 Human Coronavirus NL63, complete genome'" << endl;
 }
 
-struct Sequence {
-  string id;
-  string seq;
-};
-
-void trim(string &s) {
-  while (!s.empty() && isspace(s.back()))
-    s.pop_back();
-}
-
-int levenshteinDistance(const string &s1, const string &s2) {
-  const size_t len1 = s1.size(), len2 = s2.size();
-  if (len1 == 0) return len2;
-  if (len2 == 0) return len1;
-
-  vector<int> prev(len2 + 1), curr(len2 + 1);
-
-  for (size_t j = 0; j <= len2; ++j)
-    prev[j] = j;
-
-  for (size_t i = 1; i <= len1; ++i) {
-    curr[0] = i;
-    for (size_t j = 1; j <= len2; ++j) {
-      int cost = (toupper(s1[i - 1]) == toupper(s2[j - 1])) ? 0 : 1;
-      curr[j] = min({
-        prev[j] + 1,
-        curr[j - 1] + 1,
-        prev[j - 1] + cost
-      });
-    }
-    swap(prev, curr);
-  }
-
-  return prev[len2];
-}
-
 int main(int argc, char *argv[]) {
+  StatsReporter reporter;
   string dbFile, id1, id2;
+  int maxDistance = -1;
 
   if (argc < 7) {
     printUsage(argv[0]);
@@ -65,6 +35,10 @@ int main(int argc, char *argv[]) {
       id1 = argv[++i];
     } else if (arg == "-id2" && i + 1 < argc) {
       id2 = argv[++i];
+    } else if (arg == "-maxdist" && i + 1 < argc) {
+      maxDistance = atoi(argv[++i]);
+    } else if (arg == "--stats" || arg == "-stats") {
+      statsEnable();
     } else {
       cerr << "Argumento inválido: " << arg << endl;
       printUsage(argv[0]);
@@ -77,57 +51,51 @@ int main(int argc, char *argv[]) {
     return 1;
   }
 
-  ifstream infile(dbFile);
-  if (!infile) {
-    cerr << "Erro ao abrir o ficheiro de dados: " << dbFile << endl;
+  // Base de dados em texto ou empacotada por db_pack (procura pelo índice)
+  ScopedTimer openTimer("abrir base de dados");
+  SequenceDb db;
+  if (!db.open(dbFile))
     return 1;
-  }
-
-  vector<Sequence> sequences;
-  string line;
-  string current_id;
-  string current_seq;
+  openTimer.stop();
 
-  while (getline(infile, line)) {
-    trim(line);
-    if (line.empty()) continue;
-    if (line[0] == '@') {
-      if (!current_id.empty() && !current_seq.empty()) {
-        sequences.push_back({current_id, current_seq});
-      }
-      current_id = line.substr(1);
-      current_seq.clear();
-    } else {
-      current_seq += line;
-    }
-  }
-
-  if (!current_id.empty() && !current_seq.empty()) {
-    sequences.push_back({current_id, current_seq});
-  }
-
-  infile.close();
-
-  int n = sequences.size();
-  if (n == 0) {
+  if (db.size() == 0) {
     cerr << "Nenhuma sequência encontrada no ficheiro." << endl;
     return 1;
   }
 
-  Sequence *seq1 = nullptr, *seq2 = nullptr;
-
-  for (auto &seq : sequences) {
-    if (seq.id == id1) seq1 = &seq;
-    if (seq.id == id2) seq2 = &seq;
-  }
+  long record1 = db.find(id1);
+  long record2 = db.find(id2);
 
-  if (!seq1 || !seq2) {
+  if (record1 < 0 || record2 < 0) {
     cerr << "Erro: Um ou ambos os IDs não foram encontrados." << endl;
     return 1;
   }
 
-  int dist = levenshteinDistance(seq1->seq, seq2->seq);
-  double similarity = 1.0 - (double)dist / max(seq1->seq.size(), seq2->seq.size());
+  ScopedTimer readTimer("ler sequências");
+  string seq1 = db.sequence(record1);
+  string seq2 = db.sequence(record2);
+  readTimer.stop();
+
+  size_t maxLength = max(seq1.size(), seq2.size());
+
+  // Com -maxdist só interessa saber se a distância fica abaixo do limite, o que
+  // permite calcular apenas uma faixa de diagonais e desistir mais cedo
+  ScopedTimer distanceTimer("calcular distância");
+  if (maxDistance >= 0) {
+    int dist = levenshteinDistanceBounded(seq1, seq2, maxDistance);
+    distanceTimer.stop();
+    if (dist < 0) {
+      cout << "Distância superior a " << maxDistance << endl;
+      cout << "Similaridade: < " << 1.0 - (double)maxDistance / maxLength << endl;
+      return 0;
+    }
+    cout << "Similaridade: " << 1.0 - (double)dist / maxLength << endl;
+    return 0;
+  }
+
+  int dist = levenshteinDistance(seq1, seq2);
+  distanceTimer.stop();
+  double similarity = 1.0 - (double)dist / maxLength;
   cout << "Similaridade: " << similarity << endl;
 
   return 0;
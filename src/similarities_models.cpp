@@ -6,13 +6,21 @@
 #include <cstdlib>
 #include <algorithm>
 #include "MetaClass.hpp"
+#include "ContextCounter.hpp"
+#include "ThreadPool.hpp"
+#include "SequenceDb.hpp"
+#include "Stats.hpp"
+#include "TextUtils.hpp"
 #include <cctype>
 #include <cmath> 
+#include <cstdint>
+#include <iomanip>
 
 using namespace std;
 
 void printUsage(const string& progName) {
-    cout << "Usage: " << progName << " -db <db_file> -id1 <sequence1_id> -id2 <sequence2_id> -a <smoothing_parameter> -k <context_size>" << endl;
+    cout << "Usage: " << progName << " -db <db_file> -id1 <sequence1_id> -id2 <sequence2_id> -a <smoothing_parameter> -k <context_size> [--stats]" << endl;
+    cout << "       " << progName << " -db <db_file> -matrix <output_file> -a <smoothing_parameter> -k <context_size> [-format csv|bin] [-values similarity|nrc] [-j <threads>] [--stats]" << endl;
     cout << "Example: " << progName << "-db txt_files/db.txt -id1 'gi|49169782|ref|NC_005831.2| Human Coronavirus NL63, complete genome' -id2 'NC_005831.2 Human Coronavirus NL63, complete genome' -a 0.01 -k 13" << endl;
 }
 
@@ -22,71 +30,130 @@ struct SequenceResult {
     double nrc;
 };
 
-int charToIndex(char c) {
-    c = toupper(c);
-    switch(c) {
-        case 'A': return 0;
-        case 'C': return 1;
-        case 'G': return 2;
-        case 'T': return 3;
-        default:   return -1;
-    }
-}
+struct Sequence {
+    string id;
+    string seq;
+};
 
-unsigned long power4(int k) {
-    unsigned long res = 1;
-    for (int i = 0; i < k; i++)
-        res *= 4;
-    return res;
+// Lê todas as sequências da base de dados
+vector<Sequence> readDatabase(const SequenceDb &db) {
+    vector<Sequence> sequences(db.size());
+    for (size_t i = 0; i < db.size(); i++)
+        sequences[i] = {db.id(i), db.sequence(i)};
+    return sequences;
 }
 
-void trim(string &s) {
-    while(!s.empty() && isspace(s.back()))
-        s.pop_back();
+// Grava a matriz em CSV: primeira linha e primeira coluna com os identificadores
+void writeMatrixCsv(const string &filename, const vector<Sequence> &sequences, const vector<double> &matrix) {
+    ofstream out(filename);
+    if (!out)
+        throw runtime_error("Erro ao abrir " + filename + " para escrita");
+    size_t n = sequences.size();
+    out << setprecision(10) << "id";
+    for (const Sequence &s : sequences)
+        out << "," << csvQuote(s.id);
+    out << "\n";
+    for (size_t i = 0; i < n; i++) {
+        out << csvQuote(sequences[i].id);
+        for (size_t j = 0; j < n; j++)
+            out << "," << matrix[i * n + j];
+        out << "\n";
+    }
 }
 
-vector<int> countContexts(const string& sequence, int k) {
-    if (sequence.size() < static_cast<size_t>(k + 1))
-        throw runtime_error("Sequência demasiado curta para o valor de k fornecido.");
+// Grava a matriz em binário: "TAIX", versão (uint32), n (uint64), n identificadores
+// (comprimento uint32 + bytes) e n x n doubles por linhas
+void writeMatrixBinary(const string &filename, const vector<Sequence> &sequences, const vector<double> &matrix) {
+    ofstream out(filename, ios::binary);
+    if (!out)
+        throw runtime_error("Erro ao abrir " + filename + " para escrita");
+    const char magic[4] = {'T', 'A', 'I', 'X'};
+    uint32_t version = 1;
+    uint64_t n = sequences.size();
+    out.write(magic, sizeof(magic));
+    out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    for (const Sequence &s : sequences) {
+        uint32_t length = s.id.size();
+        out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        out.write(s.id.data(), length);
+    }
+    out.write(reinterpret_cast<const char*>(matrix.data()), matrix.size() * sizeof(double));
+    if (!out)
+        throw runtime_error("Erro a escrever a matriz em " + filename);
+}
 
-    unsigned long numContexts = power4(k);
+// Modo matriz: lê a base de dados uma vez, treina um modelo (esparso) por sequência
+// e pontua todos os pares em paralelo. nrc[i][j] é o NRC da sequência j segundo o
+// modelo da sequência i; a similaridade simétrica é exp(-(nrc[i][j] + nrc[j][i]) / 2).
+int runMatrix(const SequenceDb &db, int k, double a, int threads, const string &outputFile,
+              const string &format, const string &values) {
+    ScopedTimer readTimer("ler sequências");
+    vector<Sequence> sequences = readDatabase(db);
+    readTimer.stop();
+    size_t n = sequences.size();
+    if (n == 0) {
+        cerr << "Nenhuma sequência encontrada no ficheiro." << endl;
+        return 1;
+    }
 
-  vector<int> counts(numContexts * 4, 0);
+    ThreadPool pool(threads);
 
-    unsigned long context = 0;
-    for (int j = 0; j < k; j++) {
-        int idx = charToIndex(sequence[j]);
-        if (idx < 0)
-            throw runtime_error("Caractere inválido encontrado na sequência.");
-        context = context * 4 + idx;
-    }
+    // Cada sequência tem no máximo tantos contextos como posições, pelo que a
+    // tabela esparsa é muito menor do que a densa de 4^k contextos
+    // Uma sequência com k símbolos ou menos não tem contextos para contar: fica com
+    // uma tabela vazia (modelo uniforme) e é assinalada, em vez de falhar a matriz toda
+    ScopedTimer trainTimer("treinar");
+    vector<MetaClass> models(n);
+    pool.parallelFor(0, n, [&](size_t i) {
+        const string &seq = sequences[i].seq;
+        models[i].setSparseCounts(seq.size() > static_cast<size_t>(k) ? countContextsSparse(seq, k) : SparseTable());
+        models[i].setK(k);
+    });
+    for (const Sequence &s : sequences)
+        if (s.seq.size() <= static_cast<size_t>(k))
+            cerr << "Aviso: a sequência " << s.id << " tem " << s.seq.size()
+                 << " símbolos (não mais do que k); é usado um modelo uniforme" << endl;
 
-    int sym = charToIndex(sequence[k]);
-    if (sym >= 0)
-      counts[context * 4 + sym]++;
+    trainTimer.stop();
 
-    unsigned long highest = power4(k - 1);
+    ScopedTimer scoreTimer("pontuar");
+    vector<double> nrc(n * n);
+    pool.parallelFor(0, n, [&](size_t i) {
+        for (size_t j = 0; j < n; j++)
+            nrc[i * n + j] = models[i].computeNRC(sequences[j].seq, a);
+    });
+    scoreTimer.stop();
 
-    for (size_t i = 1; i <= sequence.size() - k - 1; i++) {
-        int new_digit = charToIndex(sequence[i + k - 1]);
-        context = (context % highest) * 4 + new_digit;
-        int next_sym = charToIndex(sequence[i + k]);
-        if (next_sym >= 0)
-            counts[context * 4 + next_sym]++;
+    vector<double> matrix = nrc;
+    if (values == "similarity") {
+        for (size_t i = 0; i < n; i++)
+            for (size_t j = 0; j < n; j++)
+                matrix[i * n + j] = exp(-(nrc[i * n + j] + nrc[j * n + i]) / 2.0);
     }
 
-    return counts;
+    ScopedTimer outputTimer("escrever resultados");
+    if (format == "bin")
+        writeMatrixBinary(outputFile, sequences, matrix);
+    else
+        writeMatrixCsv(outputFile, sequences, matrix);
+
+    cout << "Matriz " << n << "x" << n << " guardada em " << outputFile << endl;
+    return 0;
 }
 
 int main(int argc, char* argv[]){
-    if(argc < 11) {
+    StatsReporter reporter;
+    if(argc < 9) {
         printUsage(argv[0]);
         return 1;
     }
     
     string db_filename, id1, id2;
-    int k;
-    double a;
+    string matrixFile, format = "csv", values = "similarity";
+    int k = 0;
+    double a = -1.0;
+    int threads = 0;
     
     for(int i = 1; i < argc; i++){
         string arg = argv[i];
@@ -100,6 +167,16 @@ int main(int argc, char* argv[]){
             id1 = argv[++i];
         } else if(arg == "-id2" && i+1 < argc) {
             id2 = argv[++i];
+        } else if(arg == "-matrix" && i+1 < argc) {
+            matrixFile = argv[++i];
+        } else if(arg == "-format" && i+1 < argc) {
+            format = argv[++i];
+        } else if(arg == "-values" && i+1 < argc) {
+            values = argv[++i];
+        } else if(arg == "-j" && i+1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if(arg == "--stats" || arg == "-stats") {
+            statsEnable();
         } else {
             cerr << "Argumento inválido: " << arg << endl;
             printUsage(argv[0]);
@@ -107,60 +184,76 @@ int main(int argc, char* argv[]){
         }
     }
     
-    ifstream dbFile(db_filename);
-    if(!dbFile) {
-        cerr << "Erro ao abrir o ficheiro da base de dados: " << db_filename << endl;
+    if(k < 1 || k > 31) {
+        cerr << "O valor de k deve ser um inteiro entre 1 e 31." << endl;
+        return 1;
+    }
+    if(a <= 0) {
+        cerr << "O valor de alpha deve ser positivo." << endl;
         return 1;
     }
 
-    bool found1 = false, found2 = false;
-    bool reading1 = false, reading2 = false;
-    string line;
-    string seq1, seq2;
-
-    while (getline(dbFile, line)) {
-        trim(line);
-        if (line.empty()) continue;
-
-        if (line == "@" + id1) {
-            reading1 = true;
-            reading2 = false;
-            continue;
-        } else if (line == "@" + id2) {
-            reading2 = true;
-            reading1 = false;
-            continue;
-        } else if (line[0] == '@') {
-            reading1 = false;
-            reading2 = false;
-            continue;
-        }
+    // Base de dados em texto ou empacotada por db_pack
+    ScopedTimer openTimer("abrir base de dados");
+    SequenceDb db;
+    if(!db.open(db_filename))
+        return 1;
+    openTimer.stop();
 
-        if (reading1) {
-            seq1 += line;
-            found1 = true;
-        } else if (reading2) {
-            seq2 += line;
-            found2 = true;
+    if(!matrixFile.empty()) {
+        if((format != "csv" && format != "bin") || (values != "similarity" && values != "nrc") || threads < 0) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        try {
+            return runMatrix(db, k, a, threads, matrixFile, format, values);
+        } catch (const exception &e) {
+            cerr << e.what() << endl;
+            return 1;
         }
     }
+    if(id1.empty() || id2.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-    if(!found1 || !found2) {
+    // Numa base empacotada cada identificador é encontrado pelo índice, sem ler as restantes sequências
+    long record1 = db.find(id1);
+    long record2 = db.find(id2);
+    if(record1 < 0 || record2 < 0) {
         cerr << "Identificadores não encontrados na base de dados." << endl;
         return 1;
     }
+    ScopedTimer readTimer("ler sequências");
+    string seq1 = db.sequence(record1);
+    string seq2 = db.sequence(record2);
+    readTimer.stop();
     
-    vector<int> counts1 = countContexts(seq1, k);
-    vector<int> counts2 = countContexts(seq2, k);
-
+    // Como em models_generator, a tabela densa de 4^k contextos só é usada quando
+    // não ficaria quase vazia (e nunca para k >= 16, em que não caberia em memória);
+    // senão cada modelo guarda só os contextos da sua sequência. Compilar a tabela
+    // de custos só compensa quando a sequência a pontuar é maior do que a tabela
+    ScopedTimer trainTimer("treinar");
+    auto train = [k, a](MetaClass &model, const string &seq, size_t scoredLength) {
+        if (preferSparse(seq.size(), k)) {
+            model.setSparseCounts(countContextsSparse(seq, k));
+            model.setK(k);
+        } else {
+            model.setCounts(countContexts(seq, k));
+            model.setK(k);
+            if (scoredLength > model.counts.size())
+                model.compile(a);
+        }
+    };
     MetaClass model1, model2;
-    model1.setCounts(counts1);
-    model1.setK(k);
-    model2.setCounts(counts2);
-    model2.setK(k);
+    train(model1, seq1, seq2.size());
+    train(model2, seq2, seq1.size());
+    trainTimer.stop();
 
+    ScopedTimer scoreTimer("pontuar");
     double nrc12 = model1.computeNRC(seq2, a);
     double nrc21 = model2.computeNRC(seq1, a);
+    scoreTimer.stop();
     double meanNRC = (nrc12 + nrc21) / 2.0;
 
     double similarity = exp(-meanNRC);
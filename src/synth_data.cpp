@@ -0,0 +1,160 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <random>
+#include <stdexcept>
+#include "Nucleotide.hpp"
+
+using namespace std;
+
+void printUsage(const string& progName) {
+    cout << "Usage: " << progName << " -n <symbols> [-r <records>] [-gc <fraction>] [-N <density>] [-ref <meta_file> [-similar <fraction>] [-mut <rate>]] [-seed <seed>] [-o <output_file>]" << endl;
+    cout << "Example: " << progName << " -n 2000000 -gc 0.42 -o bench_data/meta.txt" << endl;
+    cout << "         " << progName << " -n 10000 -r 200 -N 0.001 -ref bench_data/meta.txt -o bench_data/db.txt" << endl;
+}
+
+// Gerador reprodutível de símbolos: ACGT com a proporção de G+C pedida e, com
+// probabilidade nDensity, um N no lugar do símbolo
+struct SymbolSource {
+    mt19937_64 rng;
+    bernoulli_distribution gc, strand, n;
+
+    SymbolSource(uint64_t seed, double gcContent, double nDensity)
+        : rng(seed), gc(gcContent), strand(0.5), n(nDensity) {}
+
+    char next() {
+        if (n(rng))
+            return 'N';
+        bool isGc = gc(rng);
+        return isGc ? (strand(rng) ? 'G' : 'C') : (strand(rng) ? 'A' : 'T');
+    }
+};
+
+// Referência só com ACGT (os restantes caracteres são ignorados)
+string readReference(const string &filename) {
+    ifstream in(filename, ios::binary);
+    if (!in)
+        throw runtime_error("Erro ao abrir o arquivo " + filename);
+    string reference;
+    char buffer[1 << 16];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0) {
+        forEachNucleotide(buffer, in.gcount(), [&reference](size_t, int sym) {
+            if (sym != NUCLEOTIDE_INVALID)
+                reference.push_back("ACGT"[sym]);
+        });
+    }
+    return reference;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    size_t length = 0;
+    size_t records = 0;
+    double gcContent = 0.5;
+    double nDensity = 0.0;
+    string referenceFilename;
+    double similar = 0.1;
+    double mutation = 0.01;
+    uint64_t seed = 1;
+    string outputFilename = "-";
+
+    // Processa os argumentos da linha de comando
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "-n" && i + 1 < argc) {
+            length = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-r" && i + 1 < argc) {
+            records = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-gc" && i + 1 < argc) {
+            gcContent = atof(argv[++i]);
+        } else if (arg == "-N" && i + 1 < argc) {
+            nDensity = atof(argv[++i]);
+        } else if (arg == "-ref" && i + 1 < argc) {
+            referenceFilename = argv[++i];
+        } else if (arg == "-similar" && i + 1 < argc) {
+            similar = atof(argv[++i]);
+        } else if (arg == "-mut" && i + 1 < argc) {
+            mutation = atof(argv[++i]);
+        } else if (arg == "-seed" && i + 1 < argc) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "-o" && i + 1 < argc) {
+            outputFilename = argv[++i];
+        } else {
+            cerr << "Argumento inválido: " << arg << endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (length == 0 || gcContent < 0 || gcContent > 1 || nDensity < 0 || nDensity > 1 ||
+        similar < 0 || similar > 1 || mutation < 0 || mutation > 1) {
+        cerr << "Parâmetros inválidos: -n > 0 e -gc, -N, -similar e -mut entre 0 e 1." << endl;
+        return 1;
+    }
+
+    try {
+        ofstream file;
+        if (outputFilename != "-") {
+            file.open(outputFilename, ios::binary);
+            if (!file)
+                throw runtime_error("Erro ao abrir " + outputFilename + " para escrita");
+        }
+        ostream &out = outputFilename == "-" ? cout : file;
+        SymbolSource source(seed, gcContent, nDensity);
+        string line;
+
+        // Sem -r: uma única sequência, em linhas de 80 símbolos como os meta*.txt
+        if (records == 0) {
+            for (size_t p = 0; p < length; p += 80) {
+                line.clear();
+                for (size_t j = p; j < min(length, p + 80); j++)
+                    line.push_back(source.next());
+                out << line << "\n";
+            }
+        } else {
+            // Com -ref, uma fração dos registos são janelas da referência com
+            // substituições à taxa -mut (e N à densidade -N); os restantes são aleatórios
+            string reference;
+            if (!referenceFilename.empty())
+                reference = readReference(referenceFilename);
+            bernoulli_distribution fromReference(reference.size() >= length ? similar : 0.0);
+            bernoulli_distribution mutate(mutation);
+            bernoulli_distribution blank(nDensity);
+            uniform_int_distribution<size_t> start(0, reference.size() >= length ? reference.size() - length : 0);
+            string seq;
+            for (size_t r = 0; r < records; r++) {
+                seq.clear();
+                if (fromReference(source.rng)) {
+                    size_t s = start(source.rng);
+                    for (size_t p = 0; p < length; p++) {
+                        char c = reference[s + p];
+                        if (blank(source.rng))
+                            c = 'N';
+                        else if (mutate(source.rng))
+                            c = "ACGT"[source.rng() & 3];
+                        seq.push_back(c);
+                    }
+                    out << "@synth" << r << " ref:" << s << "\n";
+                } else {
+                    for (size_t p = 0; p < length; p++)
+                        seq.push_back(source.next());
+                    out << "@synth" << r << " random\n";
+                }
+                for (size_t p = 0; p < length; p += 80)
+                    out << seq.substr(p, 80) << "\n";
+            }
+        }
+        out.flush();
+        if (!out)
+            throw runtime_error("Erro a escrever em " + outputFilename);
+    } catch (const exception &e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
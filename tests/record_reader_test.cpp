@@ -0,0 +1,62 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../src/RecordReader.hpp"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const string &message) {
+    if (!condition) {
+        cerr << "FALHOU: " << message << endl;
+        failures++;
+    }
+}
+
+// Lê todos os registos de text através de um ficheiro temporário
+static vector<pair<string, string>> readAll(const string &text) {
+    char path[] = "/tmp/record_reader_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0 || write(fd, text.data(), text.size()) != static_cast<ssize_t>(text.size())) {
+        cerr << "Erro a criar o ficheiro temporário" << endl;
+        exit(1);
+    }
+    lseek(fd, 0, SEEK_SET);
+    LineChannel channel(fd, -1);
+    RecordReader reader(channel);
+    vector<pair<string, string>> records;
+    string id, sequence;
+    while (reader.next(id, sequence))
+        records.emplace_back(id, sequence);
+    close(fd);
+    unlink(path);
+    return records;
+}
+
+int main() {
+    // Uma leitura FASTQ vazia (sem linha de qualidade ou com ela vazia) a meio do
+    // ficheiro é saltada e não termina a leitura
+    auto records = readAll("@a\nACGT\n+\nIIII\n@empty\n+\n@b\nGGCC\n+\n@III\n@empty2\n+\n\n@c\nTTAA\n+\nIIII\n");
+    check(records.size() == 3, "três leituras não vazias");
+    if (records.size() == 3) {
+        check(records[0] == make_pair(string("a"), string("ACGT")), "primeira leitura");
+        check(records[1] == make_pair(string("b"), string("GGCC")), "qualidade a começar por '@'");
+        check(records[2] == make_pair(string("c"), string("TTAA")), "leitura depois das vazias");
+    }
+
+    // FASTA com um registo vazio a meio
+    records = readAll(">x\nAC\nGT\n>vazio\n>y\nTT\n");
+    check(records.size() == 2 && records[1] == make_pair(string("y"), string("TT")), "FASTA com registo vazio");
+
+    // Só registos vazios
+    check(readAll("@e\n+\n\n@f\n+\n").empty(), "só leituras vazias");
+
+    if (failures == 0)
+        cout << "record_reader_test: OK" << endl;
+    return failures == 0 ? 0 : 1;
+}